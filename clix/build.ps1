@@ -2,6 +2,7 @@ param(
   [switch]$Release,
   [switch]$Run,
   [switch]$Clean,
+  [switch]$Bench,
   [string]$Cxx = "g++",
   [ValidateSet('c++17','c++20','c++23')]
   [string]$Std = "c++23",
@@ -157,6 +158,16 @@ if ($LASTEXITCODE -ne 0) { throw "g++ failed with exit code $LASTEXITCODE" }
 
 Write-Host "[build] ok -> $EXE"
 
+# ---- Thread-scaling harness (optional) ------------------------------------
+if ($Bench) {
+  $BSRC = Join-Path $ROOT "scripted_bench.cpp"
+  $BEXE = Join-Path $OUT  "bench-threads.exe"
+  Write-Host "[bench] $Cxx $($CFLAGS -join ' ') $BSRC -o $BEXE $($LFLAGS -join ' ')"
+  & $Cxx @CFLAGS $BSRC "-o" $BEXE @LFLAGS
+  if ($LASTEXITCODE -ne 0) { throw "g++ (bench) failed with exit code $LASTEXITCODE" }
+  Write-Host "[bench] ok -> $BEXE  (run: $BEXE --threads 1,2,4,8 --ms 1000)"
+}
+
 
 # ---- Stage runtime folders -------------------------------------------------
 Write-Host "[stage] plugins -> $(Join-Path $OUT 'plugins')"
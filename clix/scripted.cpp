@@ -2,12 +2,87 @@
 // g++ -std=c++23 -O2 scripted.cpp -o scripted.exe
 #include <iostream>
 #include <memory>
+#include <chrono>
+#include <iomanip>
+#include <utility>
 #include "scripted_core.hpp"
 #include "scripted_kernel.hpp" // NEW
+#include "scripted_profiler.hpp"
+#include "scripted_farm.hpp"
+#include "scripted_check.hpp"
+#include "scripted_pool.hpp"
+#include "scripted_replay.hpp"
 
 using namespace scripted;
 using std::string;
 
+// --startup-profile: wall time of each init phase since main(), on stderr.
+struct StartupProfile {
+    using clock = std::chrono::steady_clock;
+    struct Phase { string name; double ms; bool nested; };
+    bool on = false;
+    clock::time_point last = clock::now();
+    std::vector<Phase> phases;
+
+    // Lazy inits are recorded as nested in whichever phase triggered them.
+    void nested(const string& phase, double ms) { if (on) phases.push_back({phase, ms, true}); }
+    void mark(const string& phase) {
+        auto now = clock::now();
+        if (on) phases.push_back({phase, std::chrono::duration<double, std::milli>(now - last).count(), false});
+        last = now;
+    }
+    void print() {
+        if (!on || phases.empty()) return;
+        double total = 0;
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3) << std::left;
+        for (auto& p : phases) {
+            os << "startup: " << std::setw(18) << ((p.nested ? "  " : "") + p.name) << p.ms << " ms\n";
+            if (!p.nested) total += p.ms;
+        }
+        os << "startup: " << std::setw(18) << "total" << total << " ms\n";
+        std::cerr << os.str();
+        phases.clear();
+    }
+};
+
+// std::cout per thread: a :bg job's thread writes into the job's log, every
+// other thread reaches the terminal unchanged. Installed with the first job.
+class RoutedCout : public std::streambuf {
+public:
+    struct Sink {
+        std::mutex mu;
+        string text;
+    };
+    static inline thread_local Sink* sink = nullptr;
+
+    static void install() {
+        static RoutedCout buf(std::cout.rdbuf());
+        if (std::cout.rdbuf() != &buf) std::cout.rdbuf(&buf);
+    }
+    static void uninstall() {
+        if (auto* b = dynamic_cast<RoutedCout*>(std::cout.rdbuf())) std::cout.rdbuf(b->term_);
+    }
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (!sink) return term_->sputn(s, n);
+        std::lock_guard lk(sink->mu);
+        sink->text.append(s, size_t(n));
+        return n;
+    }
+    int overflow(int c) override {
+        if (c == traits_type::eof()) return 0;
+        char ch = char(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+    int sync() override { return sink ? 0 : term_->pubsync(); }
+
+private:
+    explicit RoutedCout(std::streambuf* term) : term_(term) {}
+    std::streambuf* term_;
+};
+
 struct Editor {
     Paths P;
     Config cfg;
@@ -15,9 +90,57 @@ struct Editor {
     std::unique_ptr<scripted::kernel::Kernel> K; // NEW
     std::optional<long long> current;
     bool dirty = false;
+    std::optional<Utf8Policy> utf8Override; // --strict / --repair
+    StartupProfile prof;
+    CancelToken cancel;   // re-armed per command; fired by Ctrl-C or cfg.deadlineMs
+    bool background = false;   // a :bg job's editor (plugin runs use the batch scheduler class)
+    bool cmdFailed = false;    // the running command reported a failure (see error())
+    std::unique_ptr<replay::Recorder> recorder;   // --record
 
-    void loadConfig() { cfg = ::scripted::loadConfig(P); K = std::make_unique<scripted::kernel::Kernel>(cfg, ws); }  // NEW
+    // One :bg command, run by the shared executor on an editor of its own.
+    struct Job {
+        enum class State { Queued, Running, Done, Failed, Cancelled };
+        int id = 0;
+        string command;
+        std::atomic<State> state{State::Queued};
+        std::atomic<bool> paused{false}, stop{false};
+        std::mutex tokenMu;
+        CancelToken* token = nullptr;   // the job editor's, while it runs (guarded by tokenMu)
+        RoutedCout::Sink out;
+        std::chrono::steady_clock::time_point queued = std::chrono::steady_clock::now();
+        std::atomic<std::chrono::steady_clock::rep> started{0};   // steady clock ticks; 0 while queued
+        std::atomic<double> seconds{0};                            // run time, set when finished
+        bool finished() const { auto st = state.load(); return st != State::Queued && st != State::Running; }
+        // Cancels the token directly as well: a plugin's wait loop polls expired()
+        // only, so it would never see `stop` through the yield hook.
+        void requestStop() {
+            stop = true;
+            std::lock_guard lk(tokenMu);
+            if (token) token->cancel();
+        }
+    };
+    std::vector<std::shared_ptr<Job>> jobs;
+
+    void loadConfig(bool writeDefaults = true) {
+        cfg = ::scripted::loadConfig(P, writeDefaults);
+        if (utf8Override) cfg.utf8 = *utf8Override;
+    }
+    // Plugin discovery walks plugins/, so the kernel is built on first use.
+    scripted::kernel::Kernel& kernel() {
+        if (!K) {
+            auto t0 = StartupProfile::clock::now();
+            K = std::make_unique<scripted::kernel::Kernel>(cfg, ws);
+            K->cancel = &cancel;
+            K->interactive = !background;
+            prof.nested("kernel (lazy)", std::chrono::duration<double, std::milli>(StartupProfile::clock::now() - t0).count());
+        }
+        return *K;
+    }
     void saveCfg() { saveConfig(P, cfg); }
+    // Reports a failure of the running command: dispatch() then returns
+    // Exec::Failed, so -c exits 1, a :bg job ends failed and :foreach does not
+    // checkpoint the bank.
+    void error(const string& msg) { std::cout << "ERROR: " << msg << "\n"; cmdFailed = true; }
     bool ensureCurrent() { if (!current) { std::cout << "No current context. Use :open <ctx>\n"; return false; } return true; }
 
 void help(){
@@ -49,15 +172,75 @@ Commands
   :del <addr>                    Delete from register 1
   :delr <reg> <addr>             Delete from a specific register
   :w                             Write current buffer to files/<ctx>.txt
-  :r <path>                      Read/merge a bank file (same grammar as below)
-  :resolve                       Write files/out/<ctx>.resolved.txt
-  :export                        Write files/out/<ctx>.json
+  :r <path>                      Merge a bank file into the current one (same grammar as below);
+                                reports inserted, updated and unchanged cells
+  :resolve [--index] [--profile [N]]
+                                Write files/out/<ctx>.resolved.txt (--index: plus a .idx sidecar
+                                locating every cell's value, for random access; --profile: print
+                                the N costliest cells, default 10, by exclusive resolve time)
+  :foreach <x00001..x00100|glob> [--resume] [--checkpoint <file>] <command...>
+                                Run a command with each matching bank current (e.g. :resolve);
+                                progress is checkpointed, --resume skips banks already done
+                                whose file and parse settings are unchanged
+  :farm <N> [x00001..x00100|glob] [--index]
+                                Resolve the matching bank files (default: all) in N worker
+                                processes, each owning a balanced id range; prints per-worker
+                                time, cross-worker lookups and peak memory
+  :check [-j N] [--out <file>]   Parse every bank in files/ on N threads (default: all cores) and
+                                report syntax errors (file:line), [BadRef] tokens, dangling refs,
+                                missing @file includes and reference cycles, without resolving;
+                                writes files/out/check.tsv; with -c, exits 1 when anything is found
+  :bg <command...>               Run a command as a background job on its own copy of the
+                                workspace (banks read from disk); its output goes to
+                                files/out/jobs/<id>.log; it pauses while you run commands
+  :jobs [<id> | wait [id] | cancel <id|all>]
+                                List jobs with state, time and output size; show a job's output;
+                                wait for jobs to finish; cancel jobs
+  :explain <cell> | <reg> <addr>  Resolution tree of one cell: inclusive/exclusive time, bytes,
+                                references, cycle and missing hits, @file bytes per node
+  :export [--index]              Write files/out/<ctx>.json (same --index option)
+  :peek <output> <reg> <addr>    Read one cell from an indexed output via its .idx (no parsing)
   :set prefix <char>             Set context prefix (default: x)
   :set base <n>                  Set number base (10/16/…); affects parse & show
   :set widths bank=5 addr=4 reg=2  Set zero-pad widths
+  :set utf8 strict|repair        Ill-formed UTF-8 in bank files: fail, or replace with U+FFFD
+  :set cli_cores <n>             CPUs reserved for the CLI during :plugin_run ... -j N (default 1)
+  :set artifacts tree|store      Plugin artifacts as per-run directories, or in the artifact store
+  :set artifact_keep <n>         Store retention: newest runs kept per cell and plugin (0 = all)
+  :set cold_after <sec>          Compress banks idle this long in RAM (default 300, 0 = never)
+  :set types infer|declared      Type undeclared numeric/hex registers at load, or only declared ones
+  :set deadline <t>|off          Cancel any command running longer than t (e.g. 30s, 500ms, 2m);
+                                Ctrl-C cancels the running command the same way
   :plugins                       List discovered code plugins
   :plugin_run <name> <reg> <addr> [stdin.json|inlineJSON]
                                 Run a plugin on the selected cell
+  :plugin_run <name> <reg> <from>..<to> [stdin.json|inlineJSON] [-j N]
+                                Run a plugin over every cell of reg in [from, to]
+                                (batched for plugins with "batch": true); -j N runs
+                                N processes at once, each slot pinned to its own CPUs
+  :plugin_show <name> <reg> <addr> [code|input|output|log|err|all|history] [run]
+                                Show a stored run (newest unless a run id is given)
+  :artifacts                     Artifact store size, live records, reclaimable bytes
+  :artifacts compact             Drop runs beyond artifact_keep and rewrite the segments
+  :artifacts export [dir]        Write the newest stored runs as per-run directories
+                                (default files/out/plugins)
+  :mem [--top N]                 Per-bank memory: cells, payload, map nodes, string heap, sidecars
+  :mem compact [--all]           Rebuild fragmented (or all) banks, return free heap to the OS
+  :types                         Registers of the current bank: type, cells, storage, layout
+  :type <reg> <type>             Declare a register's type: int64, float64, bytes<N>, text, or
+                                auto (drop the declaration); written to the file on :w
+  :agg <reg> [from..to]          count, sum, min, max, avg over a register (typed: packed arrays)
+  :mget <idfile> [--resolve] [--out <file>]
+                                Fetch many cells (one id per line, e.g. x00001.02.0003) in one
+                                pass grouped by bank; prints "id<TAB>value" in file order
+  :cold                          Cold tier: compressed banks, raw vs. compressed size
+  :cold now                      Compress every loaded bank except the current one
+  :profile start [hz]            Sample this process's stacks (default 99 Hz of CPU time)
+  :profile stop [file]           Write folded stacks (default files/out/profile.folded)
+  :sched                         Host scheduler queue depth, wait times, per-client share
+  :metrics                       Bank loads and plugin runs: executed vs coalesced onto one in flight
+  :bench escape                  JSON-escape throughput per SIMD level (current bank)
+  :bench utf8                    Bank load (UTF-8 + CRLF normalisation) throughput per SIMD level
   :q                             Quit (prompts if dirty)
 
 Context file format (what :w writes, what :open/:r read)
@@ -73,10 +256,13 @@ Context file format (what :w writes, what :open/:r read)
       - Title is optional; braces are required.
     • Body lines:
       - A line WITHOUT leading space/tab begins a register block: e.g. "02"
+        (optionally typed: "02 int64" | float64 | bytes<N> | text)
       - Indented lines (TAB or SPACE) are address/value entries:
             <indent><addr><whitespace><value...>
       - By default, entries go to register 1 until a register line appears.
-    • Encoding: UTF-8 (BOM optional; loader strips BOM).
+    • Encoding: UTF-8 (BOM optional; loader strips BOM). CRLF/CR become LF.
+      Ill-formed UTF-8 is replaced with U+FFFD and reported with its byte
+      offset (default, --repair) or fails the load (--strict).
     • Indentation: TAB or SPACE are both accepted for address lines.
 
 Resolver syntax (inside values)
@@ -111,6 +297,35 @@ Plugins (file-based, language-agnostic)
       input.json     — metadata + optional stdin object
       output.json    — REQUIRED plugin result (written by the plugin)
       run.log / run.err
+  Batch plugins: "batch": true in plugin.json makes range runs send many cells
+    per process: input.json is {"batch": true, "cells": [{bank, reg, addr, code,
+    stdin}, ...]} and output.json must be an array with one entry per cell (or
+    {"results": [...]}). "batch_bytes" caps input size per process (default 4 MiB).
+  memfd I/O (Linux): add "io": "memfd" to plugin.json and code.txt/input.json
+    are passed as sealed in-memory files instead ($1 and "code_file" are
+    /proc/self/fd/N paths); write the result to fd $SCRIPTED_OUTPUT_FD
+    ("output_file" in input.json) instead of output.json.
+  One-shot: `scripted -c ':open x00001' -c ':resolve'` runs the commands and exits
+    (no banner, plugins discovered only if needed); --startup-profile prints
+    per-phase init time to stderr.
+  Host scheduler (POSIX): run `scripted --sched-server [--slots N] [--job-mem MB]
+    [--weight user=N]...` once per host. Every session then takes a slot from it
+    before starting a plugin process. Each user (as the kernel reports the
+    socket peer) gets its own queue with weighted fair sharing, and one single
+    :plugin_run per user at a time is dispatched before queued range runs. The
+    socket is $SCRIPTED_SCHED, default $XDG_RUNTIME_DIR/scripted-sched.sock or
+    /tmp/scripted-sched-<uid>.sock. Without a server, plugins run unscheduled.
+  Artifact store: with `:set artifacts store`, each run's code, input, output,
+    log and stderr are appended as one record to files/out/artifacts/seg-*.dat
+    (index.tsv maps bank/reg/addr/plugin/run to offsets) instead of a directory
+    per run; plugins still see files in a reused scratch directory. Read runs
+    back with :plugin_show, reclaim space with :artifacts compact, or recreate
+    the directory layout with :artifacts export.
+  Parallel range runs: `-j N` starts N slots. On Linux the first cli_cores CPUs
+    (in socket/core order) stay with the CLI and the rest are split into N
+    contiguous sets, one per slot; each plugin process is pinned to its slot's
+    set. A per-slot summary (jobs, busy time, child CPU time, utilisation)
+    follows the results.
   Note: The working directory is the program’s CWD; place plugins/ at repo root
         (or as staged by your build script) so Kernel discovery finds them.
 
@@ -145,6 +360,8 @@ Paths & outputs
   Resolved text:    files/out/<ctx>.resolved.txt
   Exported JSON:    files/out/<ctx>.json
   Plugin outputs:   files/out/plugins/<ctx>/r<reg>a<addr>/<plugin>/output.json
+  Bloom sidecars:   files/<ctx>.bloom   (written by :w; lets lookups into
+                    unloaded banks skip the load when the cell is absent)
 
 ────────────────────────────────────────────────────────────────────────────
 )" << std::endl;
@@ -152,11 +369,13 @@ Paths & outputs
 
 
     void listCtx() {
-        if (ws.banks.empty()) { std::cout << "(no contexts)\n"; return; }
+        if (ws.banks.empty() && ws.cold.empty()) { std::cout << "(no contexts)\n"; return; }
         for (auto& [id, b] : ws.banks) {
             std::cout << cfg.prefix << toBaseN(id, cfg.base, cfg.widthBank) << "  (" << b.title << ")"
                 << (current && *current == id ? " [current]" : "") << "\n";
         }
+        for (auto& [id, c] : ws.cold)
+            std::cout << cfg.prefix << toBaseN(id, cfg.base, cfg.widthBank) << "  [cold]\n";
     }
 
     void show() {
@@ -168,15 +387,20 @@ Paths & outputs
         if (!ensureCurrent()) return;
         string err;
         if (!saveContextFile(cfg, contextFileName(cfg, *current), ws.banks[*current], err))
-            std::cout << "Write failed: " << err << "\n";
+            error("write failed: " + err);
         else { dirty = false; std::cout << "Saved " << contextFileName(cfg, *current).string() << "\n"; }
     }
 
+    // An edit is a use: the cold tier must not freeze a bank that was just edited.
+    void markDirty() { dirty = true; if (current) touchBank(ws, *current); }
+
     void insert(const string& addrTok, const string& value) {
         if (!ensureCurrent()) return;
         long long addr;
         if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout << "Bad address\n"; return; }
-        ws.banks[*current].regs[1][addr] = value; dirty = true;
+        string err;
+        if (!ws.banks[*current].set(1, addr, value, err)) { error(err); return; }
+        markDirty();
     }
 
     void insertR(const string& regTok, const string& addrTok, const string& value) {
@@ -184,16 +408,17 @@ Paths & outputs
         long long reg = 1, addr = 0;
         if (!parseIntBase(regTok, cfg.base, reg)) { std::cout << "Bad register\n"; return; }
         if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout << "Bad address\n";  return; }
-        ws.banks[*current].regs[reg][addr] = value; dirty = true;
+        string err;
+        if (!ws.banks[*current].set(reg, addr, value, err)) { error(err); return; }
+        markDirty();
     }
 
     void del(const string& addrTok) {
         if (!ensureCurrent()) return;
         long long addr; if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout << "Bad address\n"; return; }
-        auto& m = ws.banks[*current].regs[1];
-        size_t n = m.erase(addr);
+        bool n = ws.banks[*current].erase(1, addr) == 2;
         std::cout << (n ? "Deleted.\n" : "No such address.\n");
-        if (n) dirty = true;
+        if (n) markDirty();
     }
 
     void delR(const string& regTok, const string& addrTok) {
@@ -201,13 +426,10 @@ Paths & outputs
         long long reg = 1, addr = 0;
         if (!parseIntBase(regTok, cfg.base, reg)) { std::cout << "Bad register\n"; return; }
         if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout << "Bad address\n";  return; }
-        auto& regs = ws.banks[*current].regs;
-        auto itR = regs.find(reg);
-        if (itR == regs.end()) { std::cout << "No such register.\n"; return; }
-        size_t n = itR->second.erase(addr);
-        std::cout << (n ? "Deleted.\n" : "No such address.\n");
-        if (n) dirty = true;
-        if (itR->second.empty()) regs.erase(itR);
+        int r = ws.banks[*current].erase(reg, addr);
+        if (r == 0) { std::cout << "No such register.\n"; return; }
+        std::cout << (r == 2 ? "Deleted.\n" : "No such address.\n");
+        if (r == 2) markDirty();
     }
 
     void readMerge(const string& path) {
@@ -215,121 +437,1420 @@ Paths & outputs
         std::ifstream in(path, std::ios::binary);
         if (!in) { std::cout << "Cannot open " << path << "\n"; return; }
         string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        Bank tmp;
-        auto pr = parseBankText(text, cfg, tmp);
+        Bank& dst = ws.banks[*current];
+        bool untitled = dst.title.empty();
+        MergeStats st;
+        auto pr = mergeBankText(text, cfg, dst, st);
         if (!pr.ok) { std::cout << "Parse failed: " << pr.err << "\n"; return; }
-        for (auto& [rid, addrs] : tmp.regs)
-            for (auto& [aid, val] : addrs)
-                ws.banks[*current].regs[rid][aid] = val;
-        if (ws.banks[*current].title.empty()) ws.banks[*current].title = tmp.title;
-        dirty = true; std::cout << "Merged.\n";
+        if (!pr.warn.empty()) std::cout << path << ": " << pr.warn << "\n";
+        if (st.inserted || st.updated || (untitled && !dst.title.empty())) markDirty();
+        std::cout << "Merged: " << st.inserted << " inserted, " << st.updated << " updated, "
+                  << st.unchanged << " unchanged.\n";
+    }
+
+    void set(const std::vector<string>& tok) {
+        if (tok.size() >= 3 && tok[1] == "prefix" && tok[2].size() == 1) cfg.prefix = tok[2][0];
+        else if (tok.size() >= 3 && tok[1] == "base") {
+            long long b; if (!parseIntBase(tok[2], 10, b) || b < 2 || b > 36) { std::cout << "Bad base\n"; return; }
+            cfg.base = int(b);
+        }
+        else if (tok.size() >= 3 && tok[1] == "widths") {
+            for (size_t i = 2; i < tok.size(); ++i) {
+                auto eq = tok[i].find('='); long long w;
+                if (eq == string::npos || !parseIntBase(tok[i].substr(eq + 1), 10, w)) { std::cout << "Bad width: " << tok[i] << "\n"; return; }
+                string k = tok[i].substr(0, eq);
+                if (k == "bank") cfg.widthBank = int(w);
+                else if (k == "reg") cfg.widthReg = int(w);
+                else if (k == "addr") cfg.widthAddr = int(w);
+                else { std::cout << "Bad width: " << tok[i] << "\n"; return; }
+            }
+        }
+        else if (tok.size() >= 3 && tok[1] == "utf8" && (tok[2] == "strict" || tok[2] == "repair"))
+            cfg.utf8 = tok[2] == "strict" ? Utf8Policy::Strict : Utf8Policy::Repair;
+        else if (tok.size() >= 3 && tok[1] == "cli_cores") {
+            long long n; if (!parseIntBase(tok[2], 10, n) || n < 0) { std::cout << "Bad cli_cores\n"; return; }
+            cfg.cliCores = int(n);
+        }
+        else if (tok.size() >= 3 && tok[1] == "artifacts" && (tok[2] == "tree" || tok[2] == "store"))
+            cfg.artifactStore = tok[2] == "store";
+        else if (tok.size() >= 3 && tok[1] == "artifact_keep") {
+            long long n; if (!parseIntBase(tok[2], 10, n) || n < 0) { std::cout << "Bad artifact_keep\n"; return; }
+            cfg.artifactKeep = int(n);
+        }
+        else if (tok.size() >= 3 && tok[1] == "types" && (tok[2] == "infer" || tok[2] == "declared"))
+            cfg.inferTypes = tok[2] == "infer";
+        else if (tok.size() >= 3 && tok[1] == "deadline") {
+            long long n = 0, scale = 1000;
+            string t = tok[2];
+            if (t.ends_with("ms")) { scale = 1; t.resize(t.size() - 2); }
+            else if (t.ends_with("s")) t.pop_back();
+            else if (t.ends_with("m")) { scale = 60000; t.pop_back(); }
+            if (tok[2] == "off") n = 0;
+            else if (!parseIntBase(t, 10, n) || n < 0 || n > std::numeric_limits<int>::max() / scale) { std::cout << "Bad deadline\n"; return; }
+            cfg.deadlineMs = int(n * scale);
+        }
+        else if (tok.size() >= 3 && tok[1] == "cold_after") {
+            long long n; if (!parseIntBase(tok[2], 10, n) || n < 0) { std::cout << "Bad cold_after\n"; return; }
+            cfg.coldAfter = int(n);
+        }
+        else {
+            std::cout << "Usage: :set prefix <c> | base <n> | widths k=v... | utf8 strict|repair | cli_cores <n>\n"
+                         "       :set artifacts tree|store | artifact_keep <n> | cold_after <sec>\n"
+                         "       :set types infer|declared | deadline <t>|off\n";
+            return;
+        }
+        saveCfg();
+        std::cout << "OK\n";
+    }
+
+    // :plugin_run <name> <reg> <from>..<to> [stdin] [-j N]
+    void pluginRunRange(std::vector<string> tok) {
+        long long jobs = 1;
+        for (size_t i = 4; i + 1 < tok.size(); ++i)
+            if (tok[i] == "-j") {
+                if (!parseIntBase(tok[i + 1], 10, jobs) || jobs < 1) { std::cout << "Bad -j\n"; return; }
+                tok.erase(tok.begin() + static_cast<std::ptrdiff_t>(i), tok.begin() + static_cast<std::ptrdiff_t>(i) + 2);
+                break;
+            }
+        auto dots = tok[3].find("..");
+        long long r = 0, from = 0, to = 0;
+        if (!parseIntBase(tok[2], cfg.base, r) || !parseIntBase(tok[3].substr(0, dots), cfg.base, from) ||
+            !parseIntBase(tok[3].substr(dots + 2), cfg.base, to)) { std::cout << "Bad reg/range\n"; return; }
+        string stdinArg = (tok.size() >= 5 ? tok[4] : string("{}"));
+        std::vector<scripted::kernel::Kernel::CellRun> results;
+        scripted::kernel::Kernel::RangeStats stats;
+        string report;
+        size_t procs = kernel().runRange(tok[1], *current, r, from, to, stdinArg, results, report, int(jobs), &stats);
+        if (results.empty()) { error(report); return; }
+        if (!report.empty()) std::cout << report << "\n";
+        size_t ok = 0;
+        for (auto& c : results) {
+            std::cout << toBaseN(c.addr, cfg.base, cfg.widthAddr) << "\t";
+            if (c.ok) { ++ok; std::cout << trim(c.out_json) << "\n"; }
+            else error(trim(c.report));
+        }
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << results.size() << " cells, " << ok << " ok, " << procs << " plugin process(es) in " << stats.wallSec << "s\n";
+        if (jobs > 1) {
+            using scripted::kernel::cpuListString;
+            os << "cli cpus " << cpuListString(stats.cliCpus) << "\n";
+            for (size_t k = 0; k < stats.slots.size(); ++k) {
+                auto& sl = stats.slots[k];
+                double cap = stats.wallSec * double(std::max<size_t>(1, sl.cpus.size()));
+                os << "slot " << k << " cpus " << (sl.cpus.empty() ? string("-") : cpuListString(sl.cpus))
+                   << ": " << sl.jobs << " job(s), busy " << sl.busySec << "s, cpu " << sl.cpuSec
+                   << "s, util " << (cap > 0 ? 100.0 * sl.cpuSec / cap : 0.0) << "%\n";
+            }
+        }
+        std::cout << os.str();
+    }
+
+    // :plugin_show <plugin> <reg> <addr> [code|input|output|log|err|all|history] [run]
+    void pluginShow(const std::vector<string>& tok) {
+        using namespace scripted::store;
+        long long r = 0, a = 0, run = 0;
+        if (!parseIntBase(tok[2], cfg.base, r) || !parseIntBase(tok[3], cfg.base, a)) { std::cout << "Bad reg/addr\n"; return; }
+        string what = tok.size() >= 5 ? tok[4] : "output";
+        if (tok.size() >= 6 && !parseIntBase(tok[5], 10, run)) { std::cout << "Bad run id\n"; return; }
+        if (what == "history") {
+            auto runs = kernel().artifacts.history(*current, r, a, tok[1]);
+            if (runs.empty()) { std::cout << "No stored runs.\n"; return; }
+            for (auto& ref : runs)
+                std::cout << "run " << ref.run << "  exit=" << ref.exit << "  "
+                          << toBaseN(ref.first, cfg.base, cfg.widthAddr)
+                          << (ref.last != ref.first ? ".." + toBaseN(ref.last, cfg.base, cfg.widthAddr) : string())
+                          << "  " << ref.length << " bytes  t=" << ref.time << "\n";
+            return;
+        }
+        static const std::vector<std::pair<string, Field>> fields{
+            {"code", Code}, {"input", Input}, {"output", Output}, {"log", Log}, {"err", Err}};
+        if (what != "all" && std::none_of(fields.begin(), fields.end(), [&](auto& f) { return f.first == what; })) { std::cout << "Unknown field: " << what << "\n"; return; }
+        Ref ref; Artifact art; string err;
+        if (!kernel().artifacts.lookup(*current, r, a, tok[1], static_cast<uint64_t>(run), ref)) {
+            std::cout << "No stored run of " << tok[1] << " for this cell.\n"; return;
+        }
+        if (!kernel().artifacts.read(ref, art, err)) { error(err); return; }
+        std::cout << "run " << art.run << "  exit=" << art.exit;
+        if (art.first != art.last)
+            std::cout << "  batch " << toBaseN(art.first, cfg.base, cfg.widthAddr) << ".."
+                      << toBaseN(art.last, cfg.base, cfg.widthAddr);
+        std::cout << "\n";
+        string addrStr = toBaseN(a, cfg.base, cfg.widthAddr);
+        for (auto& [name, f] : fields) {
+            if (what != "all" && what != name) continue;
+            const string& v = f == Output ? scripted::kernel::Kernel::cellOutput(art, addrStr) : art.field[f];
+            if (what == "all") std::cout << "--- " << name << " (" << art.field[f].size() << " bytes)\n";
+            std::cout << v << (v.empty() || v.back() == '\n' ? "" : "\n");
+        }
     }
 
-    void resolveOut() {
+    // :artifacts [compact | export [dir]]
+    void artifactsCmd(const std::vector<string>& tok) {
+        auto print = [&](const scripted::store::Stats& st) {
+            std::cout << "artifact store " << kernel().artifacts.dir().string() << (cfg.artifactStore ? "" : " (off)") << "\n"
+                      << "  records " << st.records << " (" << st.live << " live, keep " << cfg.artifactKeep << ")"
+                      << ", segments " << st.segments << ", " << st.bytes << " bytes, "
+                      << st.deadBytes << " reclaimable\n";
+        };
+        string err;
+        if (tok.size() == 1) { print(kernel().artifacts.stats(cfg.artifactKeep)); return; }
+        if (tok[1] == "compact") {
+            scripted::store::Stats st;
+            if (!kernel().artifacts.compact(cfg.artifactKeep, st, err)) { error(err); return; }
+            print(st);
+            return;
+        }
+        if (tok[1] == "export") {
+            fs::path root = tok.size() >= 3 ? fs::path(tok[2]) : fs::path("files/out/plugins");
+            size_t n = kernel().exportArtifacts(root, err);
+            std::cout << "Exported " << n << " run(s) to " << root.string() << "\n";
+            if (!err.empty()) error(err);
+            return;
+        }
+        std::cout << "Usage: :artifacts [compact | export [dir]]\n";
+    }
+
+    static string bytesStr(uint64_t n) {
+        std::ostringstream os;
+        if (n < 1024) os << n << " B";
+        else {
+            const char* unit[] = {"KiB", "MiB", "GiB", "TiB"};
+            double v = double(n) / 1024; int u = 0;
+            while (v >= 1024 && u < 3) { v /= 1024; ++u; }
+            os << std::fixed << std::setprecision(v < 10 ? 2 : 1) << v << " " << unit[u];
+        }
+        return os.str();
+    }
+
+    // :mem [--top N] | :mem compact [--all]
+    void memCmd(const std::vector<string>& tok) {
+        if (tok.size() >= 2 && tok[1] == "compact") {
+            bool all = tok.size() >= 3 && tok[2] == "--all";
+            uint64_t rss0 = processRss(), free0 = heapFreeBytes();
+            size_t n = 0;
+            for (auto& [id, b] : ws.banks)
+                if (all || bankFragmented(bankMemory(ws, id))) { compactBank(b); ++n; }
+            for (auto& [id, bl] : ws.blooms) if (bl) bl->bits.shrink_to_fit();
+            releaseHeap();
+            uint64_t rss1 = processRss(), free1 = heapFreeBytes();
+            std::cout << "compacted " << n << " of " << ws.banks.size() << " bank(s)";
+            if (rss0) std::cout << "; RSS " << bytesStr(rss0) << " -> " << bytesStr(rss1)
+                                << " (" << (rss1 <= rss0 ? "-" : "+") << bytesStr(rss1 <= rss0 ? rss0 - rss1 : rss1 - rss0) << ")";
+            if (free0 || free1) std::cout << "; free heap " << bytesStr(free0) << " -> " << bytesStr(free1);
+            std::cout << "\n";
+            return;
+        }
+        long long top = 10;
+        if (tok.size() >= 3 && tok[1] == "--top" && !parseIntBase(tok[2], 10, top)) { std::cout << "Bad --top\n"; return; }
+        if (tok.size() >= 2 && tok[1] != "--top") { std::cout << "Usage: :mem [--top N] | :mem compact [--all]\n"; return; }
+        const size_t shown = size_t(std::max(0LL, top));
+
+        auto rows = workspaceMemory(ws);
+        BankMemory sum;
+        for (auto& m : rows) {
+            sum.cells += m.cells; sum.payload += m.payload; sum.slack += m.slack;
+            sum.nodes += m.nodes; sum.strings += m.strings; sum.columns += m.columns;
+            sum.sidecar += m.sidecar; sum.cold += m.cold;
+        }
+        std::ostringstream os;
+        os << std::left << std::setw(10) << "bank" << std::right << std::setw(10) << "cells"
+           << std::setw(12) << "payload" << std::setw(12) << "nodes" << std::setw(12) << "strings"
+           << std::setw(12) << "slack" << std::setw(12) << "typed" << std::setw(12) << "sidecar" << std::setw(12) << "cold"
+           << std::setw(12) << "total" << "\n";
+        auto row = [&](const string& name, const BankMemory& m) {
+            os << std::left << std::setw(10) << name << std::right << std::setw(10) << m.cells
+               << std::setw(12) << bytesStr(m.payload) << std::setw(12) << bytesStr(m.nodes)
+               << std::setw(12) << bytesStr(m.strings) << std::setw(12) << bytesStr(m.slack) << std::setw(12) << bytesStr(m.columns)
+               << std::setw(12) << bytesStr(m.sidecar) << std::setw(12) << bytesStr(m.cold)
+               << std::setw(12) << bytesStr(m.total()) << "\n";
+        };
+        bool starred = false, frozen = false;
+        for (size_t i = 0; i < rows.size() && i < shown; ++i) {
+            bool loaded = ws.banks.count(rows[i].id) > 0;
+            starred |= !loaded && !rows[i].isCold;
+            frozen |= rows[i].isCold;
+            row(string(1, cfg.prefix) + toBaseN(rows[i].id, cfg.base, cfg.widthBank)
+                + (loaded ? "" : rows[i].isCold ? "~" : "*"), rows[i]);
+        }
+        if (rows.size() > shown) os << "... " << rows.size() - shown << " more\n";
+        row("all", sum);
+        os << "overhead " << bytesStr(sum.overhead()) << " over " << bytesStr(sum.payload) << " of cell text";
+        if (sum.payload) os << " (" << std::fixed << std::setprecision(2) << double(sum.total()) / double(sum.payload) << "x)";
+        os << "\n";
+        if (K) os << "artifact index " << bytesStr(K->artifacts.memoryBytes()) << ", " << K->plugins.size() << " plugin manifest(s)\n";
+        if (uint64_t rss = processRss()) os << "process RSS " << bytesStr(rss);
+        if (uint64_t fr = heapFreeBytes()) os << ", allocator free " << bytesStr(fr);
+        os << "\n";
+        if (starred) os << "* sidecar only (bank not loaded)\n";
+        if (frozen) os << "~ cold tier (compressed; payload is the uncompressed cell text)\n";
+        std::cout << os.str();
+    }
+
+    // :types | :type <reg> auto|text|int64|float64|bytes<N>
+    void typeCmd(const std::vector<string>& tok) {
         if (!ensureCurrent()) return;
-        auto txt = resolveBankToText(cfg, ws, *current);
-        auto outp = outResolvedName(cfg, *current);
-        std::ofstream out(outp, std::ios::binary); out << txt;
-        std::cout << "Wrote " << outp << "\n";
+        Bank& b = ws.banks[*current];
+        if (tok[0] == ":types") {
+            std::ostringstream os;
+            os << std::left << std::setw(6) << "reg" << std::setw(12) << "type" << std::right << std::setw(10) << "cells"
+               << std::setw(12) << "storage" << "  " << "layout\n";
+            auto regName = [&](long long r) { return toBaseN(r, cfg.base, cfg.widthReg); };
+            std::vector<long long> ids;
+            for (auto& [r, m] : b.regs) ids.push_back(r);
+            for (auto& [r, c] : b.cols) ids.push_back(r);
+            std::sort(ids.begin(), ids.end());
+            for (long long r : ids) {
+                string ty = "text", layout;
+                size_t cells = 0; uint64_t bytes = 0;
+                if (auto itC = b.cols.find(r); itC != b.cols.end()) {
+                    const Column& c = itC->second;
+                    ty = colTypeName(c.spec);
+                    cells = c.size(); bytes = c.heapBytes();
+                    layout = c.dense() ? "dense" : "sparse";
+                } else {
+                    for (auto& [a, v] : b.regs.at(r)) {
+                        ++cells;
+                        bytes += heapChunk(32 + sizeof(std::pair<const long long, string>)) + stringHeap(v);
+                    }
+                    layout = "map";
+                }
+                layout += b.decl.count(r) ? ", declared" : (ty == "text" ? "" : ", inferred");
+                os << std::left << std::setw(6) << regName(r) << std::setw(12) << ty << std::right << std::setw(10) << cells
+                   << std::setw(12) << bytesStr(bytes) << "  " << layout << "\n";
+            }
+            for (auto& [r, d] : b.decl)
+                if (!b.hasReg(r)) os << std::left << std::setw(6) << regName(r) << std::setw(12) << colTypeName(d)
+                                     << std::right << std::setw(10) << 0 << std::setw(12) << "0 B" << "  declared\n";
+            std::cout << os.str();
+            return;
+        }
+        long long reg;
+        ColSpec spec;
+        if (tok.size() < 3 || !parseIntBase(tok[1], cfg.base, reg) || (tok[2] != "auto" && !parseColType(tok[2], spec))) {
+            std::cout << "Usage: :type <reg> auto|text|int64|float64|bytes<N>\n";
+            return;
+        }
+        std::optional<ColSpec> old;
+        if (auto it = b.decl.find(reg); it != b.decl.end()) old = it->second;
+        if (tok[2] == "auto") b.decl.erase(reg); else b.decl[reg] = spec;
+        string err;
+        if (!retypeRegister(b, reg, cfg.inferTypes, err)) {
+            if (old) b.decl[reg] = *old; else b.decl.erase(reg);
+            (void)retypeRegister(b, reg, cfg.inferTypes, err);
+            error(err);
+            return;
+        }
+        auto now = b.decl.find(reg);
+        if (old.has_value() != (now != b.decl.end()) || (old && !(*old == now->second))) markDirty();
+        auto itC = b.cols.find(reg);
+        std::cout << "Register " << toBaseN(reg, cfg.base, cfg.widthReg) << " is "
+                  << (itC != b.cols.end() ? colTypeName(itC->second.spec) : string("text")) << "\n";
     }
 
-    void exportJson() {
+    // :mget <idfile> [--resolve] [--out <file>]
+    void mgetCmd(const std::vector<string>& tok) {
+        string outFile; bool resolve = false;
+        for (size_t i = 2; i < tok.size(); ++i) {
+            if (tok[i] == "--resolve") resolve = true;
+            else if (tok[i] == "--out" && i + 1 < tok.size()) outFile = tok[++i];
+            else { std::cout << "Usage: :mget <idfile> [--resolve] [--out <file>]\n"; return; }
+        }
+        std::ifstream in(tok[1], std::ios::binary);
+        if (!in) { std::cout << "Cannot open " << tok[1] << "\n"; return; }
+        std::vector<string> ids;
+        std::vector<CellKey> keys;
+        size_t lineNo = 0;
+        for (string line; std::getline(in, line); ) {
+            ++lineNo;
+            auto id = trimView(line);
+            if (id.empty() || id[0] == '#') continue;
+            CellKey k;
+            if (!parseCellId(cfg, id, k)) { std::cout << tok[1] << ":" << lineNo << ": bad cell id: " << id << "\n"; return; }
+            ids.emplace_back(id);
+            keys.push_back(k);
+        }
+        using clock = std::chrono::steady_clock;
+        auto t0 = clock::now();
+        CellBatch got;
+        if (!mget(cfg, ws, keys, got, resolve, &cancel)) { std::cout << "Cancelled (" << cancel.reason() << ")\n"; return; }
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        string text;
+        size_t found = 0;
+        for (size_t i = 0; i < got.size(); ++i) {
+            text.append(ids[i]).push_back('\t');
+            if (got.found[i]) { ++found; text.append(got.value(i)); }
+            else text.append("[Missing]");
+            text.push_back('\n');
+        }
+        string err;
+        if (outFile.empty()) std::cout << text;
+        else if (!writeFileAtomic(outFile, text, err)) { error(err); return; }
+        std::ostringstream os;
+        os << ids.size() << " ids, " << found << " found, " << got.banks << " bank(s), "
+           << std::fixed << std::setprecision(2) << ms << " ms" << (outFile.empty() ? string() : "; wrote " + outFile) << "\n";
+        std::cout << os.str();
+    }
+
+    // :agg <reg> [from..to]
+    void aggCmd(const std::vector<string>& tok) {
         if (!ensureCurrent()) return;
-        auto js = exportBankToJSON(cfg, ws, *current);
-        auto outp = outJsonName(cfg, *current);
-        std::ofstream out(outp, std::ios::binary); out << js;
-        std::cout << "Wrote " << outp << "\n";
+        long long reg = 0, from = std::numeric_limits<long long>::min(), to = std::numeric_limits<long long>::max();
+        bool ok = tok.size() >= 2 && parseIntBase(tok[1], cfg.base, reg);
+        if (ok && tok.size() >= 3) {
+            auto dots = tok[2].find("..");
+            ok = dots != string::npos && parseIntBase(tok[2].substr(0, dots), cfg.base, from) &&
+                 parseIntBase(tok[2].substr(dots + 2), cfg.base, to);
+        }
+        if (!ok) { std::cout << "Usage: :agg <reg> [from..to]\n"; return; }
+        Aggregate g; string err;
+        auto t0 = std::chrono::steady_clock::now();
+        if (!aggregateRegister(ws.banks[*current], reg, from, to, g, err)) { error(err); return; }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        auto num = [](double d) { char buf[40]; return string(buf, std::to_chars(buf, buf + sizeof(buf), d).ptr); };
+        std::ostringstream os;
+        os << "count " << g.count;
+        if (g.skipped) os << " (" << g.skipped << " non-numeric skipped)";
+        if (g.count) {
+            os << "\nsum   ";
+            if (g.integral && !g.overflow) os << g.isum; else os << num(g.dsum) << (g.overflow ? " (int64 overflow; approximate)" : "");
+            if (g.integral) os << "\nmin   " << g.imin << "\nmax   " << g.imax;
+            else os << "\nmin   " << num(g.dmin) << "\nmax   " << num(g.dmax);
+            os << "\navg   " << num(g.mean());
+        }
+        auto itC = ws.banks[*current].cols.find(reg);
+        os << "\n(" << (itC != ws.banks[*current].cols.end() ? colTypeName(itC->second.spec) + " column" : string("text register"))
+           << ", " << std::fixed << std::setprecision(1) << us << " us)\n";
+        std::cout << os.str();
     }
 
-    void repl() {
-        P.ensure();
-        loadConfig();
-        std::cout << "scripted CLI — shared core\nType :help for commands.\n\n";
-        std::cout << "scripted CLI — " << scripted::platformName() << (scripted::isWSL() ? " (WSL)" : "") << "\n";
-        string line;
-        while (true) {
-            std::cout << ">> ";
-            if (!std::getline(std::cin, line)) break;
-            string s = trim(line);
-            if (s.empty()) continue;
-
-            if (s == ":help") { help(); continue; }
-            if (s == ":ls") { listCtx(); continue; }
-            if (s == ":show") { show(); continue; }
-            if (s == ":w") { write(); continue; }
-            if (s == ":preload") { preloadAll(cfg, ws); std::cout << "Preloaded " << ws.banks.size() << " banks.\n"; continue; }
-            if (s == ":resolve") { resolveOut(); continue; }
-            if (s == ":export") { exportJson(); continue; }
-            if (s == ":plugins") { K->refresh(); K->list(); continue; }
-            if (s == ":q") {
-                if (dirty) {
-                    std::cout << "Unsaved changes. Type :w to save or :q again to quit.\n>> ";
-                    string l2; if (!std::getline(std::cin, l2)) break;
-                    if (trim(l2) == ":q") break; else { s = trim(l2); }
+    static bool globMatch(std::string_view pat, std::string_view s) {
+        size_t p = 0, i = 0, star = string::npos, mark = 0;
+        while (i < s.size()) {
+            if (p < pat.size() && (pat[p] == '?' || pat[p] == s[i])) { ++p; ++i; }
+            else if (p < pat.size() && pat[p] == '*') { star = p++; mark = i; }
+            else if (star != string::npos) { p = star + 1; i = ++mark; }
+            else return false;
+        }
+        while (p < pat.size() && pat[p] == '*') ++p;
+        return p == pat.size();
+    }
+
+    // What a :foreach checkpoint remembers per bank: the size and mtime of its
+    // file and of each input its command read (`deps`: bank stems and @file
+    // names, see foreachDeps), and the config fields that change how banks
+    // parse. A bank is redone when any of them differ.
+    string bankFingerprint(const fs::path& file, const std::vector<string>& deps) const {
+        auto stamp = [](const fs::path& f) {
+            std::error_code ec;
+            auto size = fs::file_size(f, ec);
+            if (ec) return string("-");
+            return std::to_string(size) + "/" + std::to_string(fs::last_write_time(f, ec).time_since_epoch().count());
+        };
+        string key = stamp(file) + "\t" + string(1, cfg.prefix) + std::to_string(cfg.base) + "/" + std::to_string(cfg.widthBank) + "/" +
+                     std::to_string(cfg.widthReg) + "/" + std::to_string(cfg.widthAddr) +
+                     (cfg.utf8 == Utf8Policy::Strict ? "s" : "r") + (cfg.inferTypes ? "i" : "d");
+        for (auto& d : deps)
+            key += "\t" + d + "=" + stamp(d[0] == '@' ? P.root / d.substr(1) : P.root / (d + ".txt"));
+        char h[17];
+        std::snprintf(h, sizeof(h), "%016zx", std::hash<string>{}(key));
+        return h;
+    }
+    // The inputs a bank's command read besides the bank itself: other banks by
+    // stem, @file includes as "@name".
+    std::vector<string> foreachDeps(const Workspace::Reads& reads, long long self) const {
+        std::vector<string> deps;
+        for (long long b : reads.banks)
+            if (b != self) deps.push_back(string(1, cfg.prefix) + toBaseN(b, cfg.base, cfg.widthBank));
+        for (auto& f : reads.files) deps.push_back("@" + f);
+        return deps;
+    }
+
+    // Bank files (files/<prefix><id>.txt) picked by an id range "x00001..x00100"
+    // or a stem glob; "*" takes all. Prints why and returns false when none match.
+    bool selectBanks(const string& sel, std::map<long long, fs::path>& banks) {
+        auto idOf = [&](string t, long long& id) {
+            if (!t.empty() && t[0] == cfg.prefix) t.erase(0, 1);
+            return parseIntBase(t, cfg.base, id);
+        };
+        long long lo = 0, hi = -1;
+        bool byRange = sel.find("..") != string::npos;
+        if (byRange && (!idOf(sel.substr(0, sel.find("..")), lo) || !idOf(sel.substr(sel.find("..") + 2), hi))) {
+            std::cout << "Bad bank range: " << sel << "\n"; return false;
+        }
+        std::error_code ec;
+        for (auto& e : fs::directory_iterator(P.root, ec)) {
+            if (!e.is_regular_file() || e.path().extension() != ".txt") continue;
+            string stem = e.path().stem().string();
+            long long id;
+            if (stem.empty() || stem[0] != cfg.prefix || !idOf(stem, id)) continue;
+            if (byRange ? (id >= lo && id <= hi) : globMatch(sel, stem)) banks[id] = e.path();
+        }
+        if (banks.empty()) { std::cout << "No banks match " << sel << "\n"; return false; }
+        return true;
+    }
+
+    // :foreach <from>..<to>|<glob> [--resume] [--checkpoint <file>] <command...>
+    // Runs <command> with each selected bank as the current one. Banks it ran on
+    // without a failure go to a checkpoint with their fingerprints and inputs
+    // (every few seconds and at the end), which --resume reads to skip banks that
+    // are done and unchanged. Banks loaded only for the run are released as it goes.
+    void foreachCmd(const string& line) {
+        std::istringstream is(line);
+        std::vector<string> tok;
+        string command;
+        for (string t; is >> t; ) {
+            if (tok.size() >= 2 && t[0] == ':') { std::getline(is, command); command = trim(t + command); break; }
+            tok.push_back(t);
+        }
+        bool resume = false;
+        fs::path ckpt;
+        for (size_t i = 2; i < tok.size(); ++i) {
+            if (tok[i] == "--resume") resume = true;
+            else if (tok[i] == "--checkpoint" && i + 1 < tok.size()) ckpt = tok[++i];
+            else { command.clear(); break; }
+        }
+        if (tok.size() < 2 || command.empty() || command.starts_with(":foreach") || command == ":q") {
+            std::cout << "Usage: :foreach <x00001..x00100 | glob> [--resume] [--checkpoint <file>] <command...>\n";
+            return;
+        }
+
+        // One dirty flag covers the current bank only, so there must be no other
+        // unsaved bank for a command that edits to leave behind.
+        if (dirty) { std::cout << "The current bank has unsaved changes; :w first\n"; return; }
+        std::map<long long, fs::path> banks;
+        if (!selectBanks(tok[1], banks)) return;
+
+        if (ckpt.empty()) {
+            char h[17];
+            std::snprintf(h, sizeof(h), "%016zx", std::hash<string>{}(command));
+            ckpt = fs::path("files/out") / ("foreach-" + string(h) + ".ckpt");
+        }
+        // stem -> (fingerprint, inputs); a line is "stem\tfingerprint[\tinput]..."
+        std::map<string, std::pair<string, std::vector<string>>> done;
+        if (resume) {
+            std::ifstream in(ckpt, std::ios::binary);
+            string l;
+            if (in && std::getline(in, l) && l == "scripted-foreach 2" && std::getline(in, l)) {
+                if (l != "command\t" + command) { std::cout << ckpt.string() << " belongs to a different command (" << l.substr(8) << ")\n"; return; }
+                while (std::getline(in, l)) {
+                    std::vector<string> f;
+                    for (size_t a = 0, b; a <= l.size(); a = b + 1) {
+                        b = l.find('\t', a);
+                        if (b == string::npos) b = l.size();
+                        f.push_back(l.substr(a, b - a));
+                    }
+                    if (f.size() >= 2) done[f[0]] = {f[1], std::vector<string>(f.begin() + 2, f.end())};
                 }
-                else break;
             }
+        }
+        auto flush = [&] {
+            string text = "scripted-foreach 2\ncommand\t" + command + "\n", err;
+            for (auto& [stem, e] : done) {
+                text += stem + '\t' + e.first;
+                for (auto& d : e.second) text += '\t' + d;
+                text += '\n';
+            }
+            if (!writeFileAtomic(ckpt, text, err)) std::cout << "checkpoint: " << err << "\n";
+        };
 
-            // tokenized commands
-            std::istringstream is(s); std::vector<string> tok;
-            for (string t; is >> t;) tok.push_back(t);
-            if (tok.empty()) continue;
+        using clock = std::chrono::steady_clock;
+        auto lastFlush = clock::now();
+        size_t ran = 0, skipped = 0, failed = 0, sinceFlush = 0;
+        auto origCurrent = current;
+        std::set<long long> loadedBefore;   // kept; anything else loaded here is released
+        {
+            std::lock_guard lk(ws.mu);
+            for (auto& [b, bank] : ws.banks) loadedBefore.insert(b);
+            for (auto& [b, c] : ws.cold) loadedBefore.insert(b);
+        }
+        auto release = [&](long long b) { if (!loadedBefore.count(b) && b != origCurrent) unloadBank(ws, b); };
+        for (auto& [id, file] : banks) {
+            if (cancelled(&cancel)) break;
+            string stem = file.stem().string();
+            if (auto it = done.find(stem); resume && it != done.end() && it->second.first == bankFingerprint(file, it->second.second)) {
+                ++skipped;
+                continue;
+            }
+            string err;
+            if (!ensureBankLoadedInWorkspace(cfg, ws, id, err)) { std::cout << "== " << stem << ": " << err << "\n"; ++failed; continue; }
+            std::cout << "== " << stem << "\n";
+            current = id;
+            Workspace::Reads reads;
+            { std::lock_guard lk(ws.mu); ws.readSinks.push_back(&reads); }
+            Exec r = dispatch(command);
+            {
+                std::lock_guard lk(ws.mu);
+                ws.readSinks.erase(std::find(ws.readSinks.begin(), ws.readSinks.end(), &reads));
+            }
+            if (dirty) {   // left current and dirty, so :w saves it and :q asks first
+                std::cout << stem << " was modified and is now the current bank; :w it, then rerun with --resume\n";
+                origCurrent = id;
+                ++failed;
+                for (long long b : reads.banks) release(b);
+                break;
+            }
+            if (r == Exec::Ok && !cancelled(&cancel)) {
+                auto deps = foreachDeps(reads, id);
+                done[stem] = {bankFingerprint(file, deps), std::move(deps)};
+                ++ran; ++sinceFlush;
+            } else if (!cancelled(&cancel)) {
+                done.erase(stem);
+                ++failed;
+            }
+            release(id);
+            for (long long b : reads.banks) release(b);
+            if (r == Exec::Unknown) break;   // same for every bank: stop here
+            if (sinceFlush >= 64 || clock::now() - lastFlush >= std::chrono::seconds(2)) {
+                flush(); sinceFlush = 0; lastFlush = clock::now();
+            }
+        }
+        current = origCurrent;
+        flush();
+        if (failed) cmdFailed = true;
+        std::cout << "foreach: " << banks.size() << " bank(s), " << ran << " done, " << skipped << " unchanged (skipped), "
+                  << failed << " failed" << (cancelled(&cancel) ? "; cancelled (" + cancel.reason() + "), rerun with --resume" : string())
+                  << "; checkpoint " << ckpt.string() << "\n";
+    }
 
-            if (tok[0] == ":open" && tok.size() >= 2) {
-                string status; if (openCtx(cfg, ws, tok[1], status)) {
-                    string token = (tok[1][0] == cfg.prefix) ? tok[1].substr(1) : tok[1];
-                    long long id; parseIntBase(token, cfg.base, id);
-                    current = id;
-                }
-                std::cout << status << "\n"; continue;
+    // :metrics — single-flight counters: loads/runs that executed vs callers that shared one.
+    void metrics() {
+        auto line = [](const char* what, const auto& st) {
+            std::cout << what << st.executed << " executed, " << st.coalesced << " coalesced, "
+                      << st.inFlight << " in flight, peak " << st.peakWaiters << " waiter(s) on one\n";
+        };
+        line("bank loads:  ", ws.loads.stats());
+        if (K) line("plugin runs: ", K->runs.stats());
+        else std::cout << "plugin runs: (kernel not started)\n";
+    }
+
+    // :cold | :cold now
+    void coldCmd(const std::vector<string>& tok) {
+        if (tok.size() >= 2 && tok[1] == "now") {
+            uint64_t rss0 = processRss();
+            size_t n = freezeIdleBanks(ws, std::chrono::steady_clock::duration::zero(), current);
+            releaseHeap();
+            uint64_t rss1 = processRss();
+            std::cout << "froze " << n << " bank(s)";
+            if (rss0) std::cout << "; RSS " << bytesStr(rss0) << " -> " << bytesStr(rss1);
+            std::cout << "\n";
+            return;
+        }
+        if (tok.size() >= 2) { std::cout << "Usage: :cold [now]\n"; return; }
+        uint64_t raw = 0, packed = 0, text = 0;
+        std::ostringstream os;
+        std::lock_guard lk(ws.mu);
+        for (auto& [id, c] : ws.cold) {
+            raw += c.rawSize; packed += c.blob.size(); text += c.textBytes;
+            os << cfg.prefix << toBaseN(id, cfg.base, cfg.widthBank) << "  " << c.cells << " cells, "
+               << bytesStr(c.rawSize) << " -> " << bytesStr(c.blob.size()) << "\n";
+        }
+        os << ws.cold.size() << " cold bank(s), " << bytesStr(text) << " of cell text in " << bytesStr(packed);
+        if (packed) os << " (" << std::fixed << std::setprecision(2) << double(raw) / double(packed) << "x)";
+        os << "; " << ws.banks.size() << " loaded, idle after "
+           << (cfg.coldAfter ? std::to_string(cfg.coldAfter) + " s" : string("never")) << "\n";
+        std::cout << os.str();
+    }
+
+    // :profile start [hz] | :profile stop [file] | :profile
+    void profileCmd(const std::vector<string>& tok) {
+        string err;
+        if (tok.size() >= 2 && tok[1] == "start") {
+            long long hz = 99;
+            if (tok.size() >= 3 && !parseIntBase(tok[2], 10, hz)) { std::cout << "Bad hz\n"; return; }
+            if (!scripted::prof::start(int(hz), err)) { error(err); return; }
+            std::cout << "Profiling at " << hz << " Hz of CPU time. :profile stop [file] writes folded stacks.\n";
+            return;
+        }
+        if (tok.size() >= 2 && tok[1] == "stop") {
+            fs::path out = tok.size() >= 3 ? fs::path(tok[2]) : P.outdir / "profile.folded";
+            scripted::prof::Summary sum;
+            if (!scripted::prof::stop(out, sum, err)) { error(err); return; }
+            std::cout << "Wrote " << out.string() << ": " << sum.samples << " samples, " << sum.stacks
+                      << " distinct stacks over " << sum.seconds << " s";
+            if (sum.dropped) std::cout << " (" << sum.dropped << " dropped: buffer full)";
+            std::cout << "\n";
+            return;
+        }
+        if (tok.size() == 1) { std::cout << (scripted::prof::running() ? "profiler running\n" : "profiler stopped\n"); return; }
+        std::cout << "Usage: :profile start [hz] | :profile stop [file]\n";
+    }
+
+    // :farm <N> [<from>..<to>|<glob>] [--index]
+    void farmCmd(const std::vector<string>& tok) {
+        long long n = 0;
+        string sel = "*";
+        bool withIndex = false, bad = tok.size() < 2 || !parseIntBase(tok[1], 10, n) || n < 1 || n > 256;
+        for (size_t i = 2; i < tok.size() && !bad; ++i) {
+            if (tok[i] == "--index") withIndex = true;
+            else if (tok[i][0] != '-' && sel == "*") sel = tok[i];
+            else bad = true;
+        }
+        if (bad) { std::cout << "Usage: :farm <N> [x00001..x00100 | glob] [--index]\n"; return; }
+        std::map<long long, fs::path> banks;
+        if (!selectBanks(sel, banks)) return;
+        if (dirty && current && banks.count(*current)) std::cout << "Note: unsaved edits to the current bank are not seen by the farm (:w first)\n";
+        farm::Options opt;
+        opt.workers = int(n);
+        opt.index = withIndex;
+        opt.banks.assign(banks.begin(), banks.end());
+        farm::Report rep;
+        string err;
+        bool ok = farm::run(cfg, &cancel, opt, rep, err);
+        if (!ok && rep.workers.empty()) { error(err); return; }
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(1);
+        auto bankName = [&](long long id) { return string(1, cfg.prefix) + toBaseN(id, cfg.base, cfg.widthBank); };
+        size_t done = 0, failed = 0, peerLost = 0, lost = 0;
+        for (size_t w = 0; w < rep.workers.size(); ++w) {
+            auto& r = rep.workers[w];
+            os << "  worker " << w << "  " << bankName(r.first) << ".." << bankName(r.last) << "  " << r.done << "/" << r.banks << " banks"
+               << "  est " << r.estMs << " ms  busy " << r.busyMs << " ms  asked " << r.asked << "  served " << r.served
+               << "  rss " << r.rssKb / 1024.0 << " MiB";
+            if (!r.finished) { os << "  (no report: worker died)"; ++lost; }
+            else if (r.cancelled) os << "  (cancelled)";
+            os << "\n";
+            done += r.done; failed += r.failed; peerLost += r.peerLost;
+        }
+        os << "Farm: " << done << "/" << banks.size() << " banks resolved";
+        if (failed) os << ", " << failed << " failed";
+        if (peerLost) os << " (" << peerLost << " because a worker holding their references could not be reached)";
+        os << " by " << rep.workers.size() << " workers in " << rep.wallSec << " s\n";
+        std::cout << os.str();
+        if (!ok) error(err);
+        else if (failed || lost) cmdFailed = true;
+        if (cancelled(&cancel)) std::cout << "Cancelled (" << cancel.reason() << "); banks not reported above keep their previous output\n";
+        else if (lost) std::cout << lost << " worker(s) died; their banks keep their previous output\n";
+    }
+
+    // :check [-j N] [--out <file>]; false when the workspace has issues.
+    bool checkCmd(const std::vector<string>& tok) {
+        long long jobs = std::max(1u, std::thread::hardware_concurrency());
+        fs::path outp = "files/out/check.tsv";
+        for (size_t i = 1; i < tok.size(); ++i) {
+            if (tok[i] == "-j" && i + 1 < tok.size() && parseIntBase(tok[i + 1], 10, jobs) && jobs >= 1) ++i;
+            else if (tok[i] == "--out" && i + 1 < tok.size()) outp = tok[++i];
+            else { std::cout << "Usage: :check [-j N] [--out <file>]\n"; return false; }
+        }
+        check::Options opt;
+        opt.jobs = int(std::min(jobs, 256LL));
+        std::map<long long, fs::path> banks;
+        if (!selectBanks("*", banks)) return false;
+        opt.banks.assign(banks.begin(), banks.end());
+        if (dirty) std::cout << "Note: unsaved edits are not checked (:w first)\n";
+        check::Report rep;
+        if (!check::run(cfg, &cancel, opt, rep)) { std::cout << "Cancelled (" << cancel.reason() << "); nothing written\n"; return false; }
+        string err;
+        if (!writeFileAtomic(outp, check::toTSV(rep), err)) error(err);
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        const size_t shown = 20;
+        for (size_t k = 0; k < rep.issues.size() && k < shown; ++k)
+            os << "  " << std::left << std::setw(13) << rep.issues[k].kind << std::right << rep.issues[k].where << "  " << rep.issues[k].what << "\n";
+        if (rep.issues.size() > shown) os << "  ... " << rep.issues.size() - shown << " more\n";
+        os << "Checked " << rep.banks << " banks, " << rep.cells << " cells, " << rep.refs << " refs with " << opt.jobs
+           << " threads in " << rep.wallSec << " s: ";
+        if (rep.issues.empty()) os << "no issues";
+        for (auto it = rep.counts.begin(); it != rep.counts.end(); ++it)
+            os << (it == rep.counts.begin() ? "" : ", ") << it->second << " " << it->first;
+        if (rep.unparsable) os << " (" << rep.unparsable << " bank(s) did not parse)";
+        os << "\nWrote " << outp.string() << "\n";
+        std::cout << os.str();
+        return rep.issues.empty();
+    }
+
+    // Commands a :bg job may not run: they drive the job list, the process-wide
+    // profiler, files/config.json or fork(), which belong to the CLI thread.
+    static bool bgAllowed(const string& command) {
+        string head = command.substr(0, command.find(' '));
+        for (const char* no : {":q", ":bg", ":jobs", ":profile", ":set", ":farm"}) if (head == no) return false;
+        return true;
+    }
+
+    // :bg <command...> — runs <command> on the shared executor at background
+    // priority, on an editor of its own (same config, same current bank, read
+    // from disk). Its output is kept for :jobs <id> and files/out/jobs/<id>.log.
+    void bgCmd(const string& line) {
+        string command = trim(line.substr(3));
+        if (command.empty() || command[0] != ':' || !bgAllowed(command)) {
+            std::cout << "Usage: :bg <command...>   (e.g. :bg :export, :bg :foreach x00001..x00100 :resolve;"
+                         " not :q, :bg, :jobs, :profile, :set or :farm)\n";
+            return;
+        }
+        RoutedCout::install();
+        auto job = std::make_shared<Job>();
+        job->id = jobs.empty() ? 1 : jobs.back()->id + 1;
+        job->command = command;
+        auto child = std::make_shared<Editor>();
+        child->P = P;
+        child->cfg = cfg;
+        child->utf8Override = utf8Override;
+        child->background = true;
+        job->token = &child->cancel;
+        // Every cancellation check in the job is also where it stops or yields.
+        child->cancel.yield = [j = job.get(), tok = &child->cancel] {
+            auto& ex = pool::shared();
+            if (ex.interactiveActive() && !j->stop.load()) {
+                j->paused = true;
+                ex.pauseForInteractive(&j->stop);
+                j->paused = false;
             }
+            if (j->stop.load()) tok->cancel();
+        };
+        string open = current ? ":open " + string(1, cfg.prefix) + toBaseN(*current, cfg.base, cfg.widthBank) : string();
+        if (current && dirty) std::cout << "Note: the job reads " << open.substr(6) << " from disk; unsaved edits are not seen (:w first)\n";
+        pool::shared().submit([job, child, open] {
+            job->started = std::chrono::steady_clock::now().time_since_epoch().count();
+            job->state = Job::State::Running;
+            RoutedCout::sink = &job->out;
+            Exec r = Exec::Ok;
+            if (!open.empty()) r = child->dispatch(open);
+            if (r == Exec::Ok && !job->stop) r = child->dispatch(job->command);
+            if (child->dirty) std::cout << "(the job's unsaved changes were discarded)\n";
+            { std::lock_guard lk(job->tokenMu); job->token = nullptr; }
+            RoutedCout::sink = nullptr;
+            auto t0 = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(job->started.load()));
+            job->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            string err, text;
+            { std::lock_guard lk(job->out.mu); text = job->out.text; }
+            (void)writeFileAtomic(fs::path("files/out/jobs") / (std::to_string(job->id) + ".log"), text, err);
+            job->state = job->stop || child->cancel.expired() ? Job::State::Cancelled
+                       : r == Exec::Ok ? Job::State::Done : Job::State::Failed;
+        }, pool::Priority::Background);
+        jobs.push_back(job);
+        std::cout << "[" << job->id << "] " << command << "\n";
+    }
+
+    static const char* jobState(const Job& j) {
+        switch (j.state.load()) {
+            case Job::State::Queued:    return "queued";
+            case Job::State::Running:   return j.paused ? "paused" : "running";
+            case Job::State::Done:      return "done";
+            case Job::State::Failed:    return "failed";
+            case Job::State::Cancelled: return "cancelled";
+        }
+        return "?";
+    }
+    std::shared_ptr<Job> findJob(const string& id) {
+        for (auto& j : jobs) if (std::to_string(j->id) == id) return j;
+        std::cout << "No job " << id << "\n";
+        return nullptr;
+    }
 
-            if (tok[0] == ":switch" && tok.size() >= 2) {
-                string name = tok[1]; if (name.size() > 4 && name.ends_with(".txt")) name = name.substr(0, name.size() - 4);
-                string token = (name[0] == cfg.prefix) ? name.substr(1) : name;
-                long long id; if (!parseIntBase(token, cfg.base, id)) { std::cout << "Bad id\n"; continue; }
-                if (!ws.banks.count(id)) {
-                    string status; if (!openCtx(cfg, ws, name, status)) { std::cout << status << "\n"; continue; }
+    // :jobs | :jobs <id> | :jobs cancel <id|all> | :jobs wait [id]
+    void jobsCmd(const std::vector<string>& tok) {
+        if (tok.size() == 1) {
+            if (jobs.empty()) { std::cout << "(no jobs)\n"; return; }
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(1);
+            auto now = std::chrono::steady_clock::now();
+            for (auto& j : jobs) {
+                double secs = j->seconds;
+                if (!j->finished() && j->started)
+                    secs = std::chrono::duration<double>(now - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(j->started.load()))).count();
+                size_t bytes;
+                { std::lock_guard lk(j->out.mu); bytes = j->out.text.size(); }
+                os << "[" << j->id << "] " << std::left << std::setw(10) << jobState(*j) << std::right << std::setw(8) << secs << " s  "
+                   << std::setw(8) << bytes << " B out  " << j->command << "\n";
+            }
+            auto st = pool::shared().stats();
+            os << "executor: " << st.workers << " workers, queued " << st.queued[0] << " interactive / " << st.queued[1]
+               << " background, " << st.executed << " run, " << st.stolen << " stolen\n";
+            std::cout << os.str();
+            return;
+        }
+        if (tok.size() == 2 && tok[1] != "wait" && tok[1] != "cancel") {
+            auto j = findJob(tok[1]);
+            if (!j) return;
+            string text;
+            { std::lock_guard lk(j->out.mu); text = j->out.text; }
+            std::cout << text << (text.empty() || text.back() == '\n' ? "" : "\n") << "[" << j->id << "] " << jobState(*j) << "\n";
+            return;
+        }
+        if (tok[1] == "cancel" && tok.size() == 3) {
+            for (auto& j : jobs)
+                if ((tok[2] == "all" || std::to_string(j->id) == tok[2]) && !j->finished()) {
+                    j->requestStop();
+                    std::cout << "[" << j->id << "] cancelling\n";
                 }
-                current = id; std::cout << "Switched to " << name << "\n"; continue;
+            pool::shared().nudge();
+            return;
+        }
+        if (tok[1] == "wait" && tok.size() <= 3) {
+            // Runs without an InteractiveScope (see execute), so jobs keep going meanwhile.
+            std::vector<std::shared_ptr<Job>> wait;
+            if (tok.size() == 3) { auto j = findJob(tok[2]); if (!j) return; wait.push_back(j); }
+            else wait = jobs;
+            for (auto& j : wait) {
+                while (!j->finished() && !cancelled(&cancel)) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if (!j->finished()) { std::cout << "Stopped waiting (" << cancel.reason() << ")\n"; return; }
+                std::cout << "[" << j->id << "] " << jobState(*j) << "  " << j->command << "\n";
             }
+            return;
+        }
+        std::cout << "Usage: :jobs | :jobs <id> | :jobs cancel <id|all> | :jobs wait [id]\n";
+    }
 
-            if (tok[0] == ":ins" && tok.size() >= 3) {
-                string value; for (size_t i = 2; i < tok.size(); ++i) { if (i > 2) value.push_back(' '); value += tok[i]; }
-                insert(tok[1], value); continue;
-            }
-            if (tok[0] == ":insr" && tok.size() >= 4) {
-                string value; for (size_t i = 3; i < tok.size(); ++i) { if (i > 3) value.push_back(' '); value += tok[i]; }
-                insertR(tok[1], tok[2], value); continue;
+    // At exit: cancels unfinished jobs and waits for them to unwind.
+    void stopJobs() {
+        size_t live = 0;
+        for (auto& j : jobs) if (!j->finished()) { j->requestStop(); ++live; }
+        if (!live) { RoutedCout::uninstall(); return; }
+        std::cout << "Cancelling " << live << " background job(s)...\n";
+        pool::shared().nudge();
+        for (auto& j : jobs) while (!j->finished()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        RoutedCout::uninstall();
+    }
+
+    // Both exporters write through a temp file, so a cancelled or failed run
+    // leaves the previous output in place. Without --index, an older .idx is
+    // removed so no reader pairs it with the new output.
+    void writeOutput(const fs::path& outp, const string& text, const std::vector<outidx::Entry>* index) {
+        string err;
+        // The old index goes first, so no reader pairs it with the new output.
+        fs::path ip = outidx::indexPath(outp);
+        std::error_code ec;
+        fs::remove(ip, ec);
+        if (!writeFileAtomic(outp, text, err)) { error(err); return; }
+        if (!index) { std::cout << "Wrote " << outp.string() << "\n"; return; }
+        outidx::Stamp st;
+        if (!outidx::stampOf(outp, st)) { error("cannot stat " + outp.string()); return; }
+        if (!writeFileAtomic(ip, outidx::encode(*index, st), err)) { error(err); return; }
+        std::cout << "Wrote " << outp.string() << " and " << ip.string() << " (" << index->size() << " cells)\n";
+    }
+
+    // :resolve [--index] [--profile [N]]
+    void resolveOut(const std::vector<string>& tok) {
+        if (!ensureCurrent()) return;
+        bool withIndex = false, profile = false;
+        long long topN = 10;
+        for (size_t i = 1; i < tok.size(); ++i) {
+            if (tok[i] == "--index") withIndex = true;
+            else if (tok[i] == "--profile") {
+                profile = true;
+                if (i + 1 < tok.size() && tok[i + 1][0] != '-' && !parseIntBase(tok[++i], 10, topN)) topN = -1;
+                if (topN < 1) { std::cout << "Bad --profile count\n"; return; }
             }
-            if (tok[0] == ":del" && tok.size() >= 2) { del(tok[1]); continue; }
-            if (tok[0] == ":delr" && tok.size() >= 3) { delR(tok[1], tok[2]); continue; }
-            if (tok[0] == ":r" && tok.size() >= 2) { readMerge(tok[1]); continue; }
-
-            // NEW: plugin run
-            if (tok[0] == ":plugin_run" && tok.size() >= 4) {
-                if (!ensureCurrent()) { std::cout << "Open a context first\n"; continue; }
-                long long r = 0, a = 0;
-                if (!parseIntBase(tok[2], cfg.base, r) || !parseIntBase(tok[3], cfg.base, a)) { std::cout << "Bad reg/addr\n"; continue; }
-                string stdinArg = (tok.size() >= 5 ? tok[4] : string("{}"));
-                string out_json, report;
-                bool ok = K->run(tok[1], *current, r, a, stdinArg, out_json, report);
-                if (!ok) std::cout << "ERROR: " << report << "\n";
-                else {
-                    std::cout << "output.json:\n" << out_json << "\n";
-                    if (!report.empty()) std::cout << report;
+            else { std::cout << "Usage: :resolve [--index] [--profile [N]]\n"; return; }
+        }
+        string txt;
+        std::vector<outidx::Entry> index;
+        ResolveTrace trace;
+        auto t0 = ResolveTrace::clock::now();
+        if (!resolveBankToText(cfg, ws, *current, txt, &cancel, withIndex ? &index : nullptr, profile ? &trace : nullptr)) { std::cout << "Cancelled (" << cancel.reason() << "); nothing written\n"; return; }
+        double ms = std::chrono::duration<double, std::milli>(ResolveTrace::clock::now() - t0).count();
+        writeOutput(outResolvedName(cfg, *current), txt, withIndex ? &index : nullptr);
+        if (!profile) return;
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3) << "resolve: " << ms << " ms, " << trace.cells.size()
+           << " distinct cells expanded (workspace-wide); costliest by exclusive time:\n";
+        printTraceHeader(os);
+        for (auto& [k, st] : trace.top(size_t(topN))) printTraceRow(os, cellName(k), st);
+        std::cout << os.str();
+    }
+
+    string cellName(const CellKey& k) const {
+        return string(1, cfg.prefix) + toBaseN(k.bank, cfg.base, cfg.widthBank) + "." +
+               toBaseN(k.reg, cfg.base, cfg.widthReg) + "." + toBaseN(k.addr, cfg.base, cfg.widthAddr);
+    }
+    static void printTraceHeader(std::ostream& os) {
+        os << std::left << std::setw(24) << "cell" << std::right << std::setw(7) << "calls" << std::setw(11) << "incl ms"
+                  << std::setw(11) << "excl ms" << std::setw(10) << "bytes" << std::setw(6) << "refs" << std::setw(5) << "cyc"
+                  << std::setw(6) << "miss" << std::setw(10) << "include" << "\n";
+    }
+    static void printTraceRow(std::ostream& os, const string& label, const ResolveTrace::Stats& st) {
+        os << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(7) << st.calls << std::setw(11) << double(st.inclNs) / 1e6 << std::setw(11) << double(st.exclNs) / 1e6
+                  << std::setw(10) << st.bytes << std::setw(6) << st.refs << std::setw(5) << st.cycles << std::setw(6) << st.missing
+                  << std::setw(10) << st.includeBytes << "\n";
+    }
+
+    // :explain <cell> | :explain <reg> <addr> — the resolution tree of one cell with per-node costs
+    void explain(const std::vector<string>& tok) {
+        CellKey k;
+        bool ok = false;
+        if (tok.size() == 2) ok = parseCellId(cfg, tok[1], k);
+        else if (tok.size() == 3 && ensureCurrent()) {
+            k.bank = *current;
+            ok = parseIntBase(tok[1], cfg.base, k.reg) && parseIntBase(tok[2], cfg.base, k.addr);
+        }
+        if (!ok) { std::cout << "Usage: :explain <cell id, e.g. x00001.02.0003> | :explain <reg> <addr>\n"; return; }
+        Resolver R(cfg, ws, &cancel);
+        string raw;
+        if (!R.getValue(k.bank, k.reg, k.addr, raw)) { std::cout << "No cell " << cellName(k) << "\n"; return; }
+        ResolveTrace trace;
+        trace.keepTree = true;
+        R.trace = &trace;
+        std::unordered_set<string> visited;
+        string out = R.resolveCell(raw, k, visited);
+        if (cancelled(&cancel)) { std::cout << "Cancelled (" << cancel.reason() << ")\n"; return; }
+        constexpr size_t kMaxNodes = 200;
+        std::ostringstream os;
+        printTraceHeader(os);
+        for (size_t i = 0; i < trace.tree.size() && i < kMaxNodes; ++i) {
+            auto& n = trace.tree[i];
+            printTraceRow(os, string(size_t(2 * std::min(n.depth, 8)), ' ') + cellName(n.key), n.s);
+        }
+        std::cout << os.str();
+        if (trace.tree.size() > kMaxNodes) std::cout << "... " << trace.tree.size() - kMaxNodes << " more node(s)\n";
+        std::cout << trace.tree.size() << " node(s), " << trace.cells.size() << " distinct cell(s), "
+                  << out.size() << " bytes resolved\n";
+    }
+
+    void exportJson(bool withIndex) {
+        if (!ensureCurrent()) return;
+        string js;
+        std::vector<outidx::Entry> index;
+        if (!exportBankToJSON(cfg, ws, *current, js, &cancel, withIndex ? &index : nullptr)) { std::cout << "Cancelled (" << cancel.reason() << "); nothing written\n"; return; }
+        writeOutput(outJsonName(cfg, *current), js, withIndex ? &index : nullptr);
+    }
+
+    // :peek <output> <reg> <addr> — one cell through the output's .idx, without parsing the output
+    void peek(const std::vector<string>& tok) {
+        long long r = 0, a = 0;
+        if (!parseIntBase(tok[2], cfg.base, r) || !parseIntBase(tok[3], cfg.base, a)) { std::cout << "Bad reg/addr\n"; return; }
+        outidx::Reader rd; string err;
+        if (!rd.open(tok[1], err)) { error(err); return; }
+        auto v = rd.get(r, a);
+        if (!v) { std::cout << "(no cell " << tok[2] << " " << tok[3] << " in " << tok[1] << ")\n"; return; }
+        std::cout << *v << "\n";
+    }
+
+    // Escape throughput over the current bank's resolved values (what :export writes),
+    // once per SIMD level this CPU supports.
+    void benchEscape() {
+        if (!ensureCurrent()) return;
+        Resolver R(cfg, ws);
+        std::vector<string> vals;
+        size_t bytes = 0;
+        ws.banks[*current].forEachCell([&](long long, long long, const string& val) {
+            std::unordered_set<string> visited;
+            vals.push_back(R.resolve(val, *current, visited));
+            bytes += vals.back().size();
+        });
+        if (bytes == 0) { std::cout << "Nothing to escape (empty bank).\n"; return; }
+        string reference;
+        for (auto& v : vals) jsonEscapeAppend(reference, v, SimdLevel::Scalar);
+        std::cout << "escape bench: " << vals.size() << " values, " << bytes << " bytes\n";
+        for (SimdLevel lvl : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            if (lvl > simdLevel()) break;
+            using clock = std::chrono::steady_clock;
+            string out; out.reserve(reference.size());
+            size_t iters = 0; double secs = 0;
+            auto t0 = clock::now();
+            do {
+                out.clear();
+                for (auto& v : vals) jsonEscapeAppend(out, v, lvl);
+                ++iters;
+                secs = std::chrono::duration<double>(clock::now() - t0).count();
+            } while (secs < 0.2);
+            double mbs = double(bytes) * double(iters) / secs / 1e6;
+            std::cout << "  " << simdLevelName(lvl) << ": " << mbs << " MB/s"
+                      << (out == reference ? "" : "  (MISMATCH)") << "\n";
+        }
+    }
+
+    // Load-path throughput: BOM strip + UTF-8 validation + CR normalisation over
+    // every bank file in files/, once per SIMD level.
+    void benchUtf8() {
+        std::vector<string> texts;
+        size_t bytes = 0;
+        for (auto& e : fs::directory_iterator(P.root)) {
+            if (!e.is_regular_file() || e.path().extension() != ".txt") continue;
+            std::ifstream in(e.path(), std::ios::binary);
+            texts.emplace_back((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            bytes += texts.back().size();
+        }
+        if (bytes == 0) { std::cout << "No bank files in " << P.root.string() << "\n"; return; }
+        std::cout << "utf8 bench: " << texts.size() << " files, " << bytes << " bytes\n";
+        for (SimdLevel lvl : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            if (lvl > simdLevel()) break;
+            using clock = std::chrono::steady_clock;
+            size_t iters = 0, invalid = 0; double secs = 0;
+            auto t0 = clock::now();
+            do {
+                invalid = 0;
+                for (auto& t : texts) {
+                    string copy = t; TextCheck chk; string err;
+                    (void)normalizeBankText(copy, Utf8Policy::Repair, chk, err, lvl);
+                    invalid += chk.invalid;
                 }
-                continue;
+                ++iters;
+                secs = std::chrono::duration<double>(clock::now() - t0).count();
+            } while (secs < 0.2);
+            std::cout << "  " << simdLevelName(lvl) << ": " << double(bytes) * double(iters) / secs / 1e6
+                      << " MB/s (" << invalid << " invalid sequences)\n";
+        }
+    }
+
+    enum class Exec { Ok, Quit, Unknown, Failed };   // Failed: ran and found problems (-c exits 1)
+
+    static const char* execName(Exec r) {
+        switch (r) {
+            case Exec::Ok:      return "ok";
+            case Exec::Quit:    return "quit";
+            case Exec::Unknown: return "unknown";
+            case Exec::Failed:  return "failed";
+        }
+        return "?";
+    }
+
+    // Runs one command line (REPL input or a -c argument); with --record, logs it.
+    Exec execute(const string& line) {
+        if (!recorder || trim(line).empty()) return run(line);
+        double at = recorder->elapsedMs();
+        auto t0 = std::chrono::steady_clock::now();
+        Exec r = run(line);
+        recorder->add({at, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(),
+                       execName(r), trim(line)});
+        return r;
+    }
+
+    Exec run(const string& line) {
+        string s = trim(line);
+        if (s.empty()) return Exec::Ok;
+        if (s == ":q") return Exec::Quit;
+        cancel.arm(cfg.deadlineMs);
+        SigintScope sigint(cancel);
+        // Background jobs hold still while a command runs, except while waiting on them.
+        std::optional<pool::Executor::InteractiveScope> fg;
+        if (!jobs.empty() && !s.starts_with(":jobs wait")) fg.emplace(pool::shared());
+        if (cfg.coldAfter > 0) freezeIdleBanks(ws, std::chrono::seconds(cfg.coldAfter), current);
+        return dispatch(s);
+    }
+
+    // One trimmed command, under the deadline and Ctrl-C handling execute() set up
+    // (so :foreach can run a command per bank as one cancellable unit). A command
+    // that reported an error() counts as failed.
+    Exec dispatch(const string& s) {
+        bool outer = std::exchange(cmdFailed, false);
+        Exec r = dispatchCmd(s);
+        if (cmdFailed && r == Exec::Ok) r = Exec::Failed;
+        cmdFailed = outer;
+        return r;
+    }
+    Exec dispatchCmd(const string& s) {
+        // Also reached from a :bg :foreach, which bgCmd does not see into.
+        if (background && !bgAllowed(s)) {
+            std::cout << s.substr(0, s.find(' ')) << " cannot run in a background job\n";
+            return Exec::Unknown;
+        }
+        // The profiler's label table belongs to the CLI thread; :bg jobs leave it alone.
+        if (!background && scripted::prof::running())
+            scripted::prof::setContext(s.substr(0, s.find(' ')) +
+                (current ? ";bank " + string(1, cfg.prefix) + toBaseN(*current, cfg.base, cfg.widthBank) : string()));
+
+        if (s == ":help") { help(); return Exec::Ok; }
+        if (s == ":ls") { listCtx(); return Exec::Ok; }
+        if (s == ":show") { show(); return Exec::Ok; }
+        if (s == ":w") { write(); return Exec::Ok; }
+        if (s == ":preload") {
+            bool done = preloadAll(cfg, ws, &cancel);
+            std::cout << "Preloaded " << ws.banks.size() << " banks."
+                      << (done ? string() : " Cancelled (" + cancel.reason() + ") before the rest.") << "\n";
+            return Exec::Ok;
+        }
+        if (s == ":export" || s == ":export --index") { exportJson(s.ends_with("--index")); return Exec::Ok; }
+        if (s == ":plugins") { kernel().refresh(); kernel().list(); return Exec::Ok; }
+        if (s == ":metrics") { metrics(); return Exec::Ok; }
+        if (s == ":bench escape") { benchEscape(); return Exec::Ok; }
+        if (s == ":bench utf8") { benchUtf8(); return Exec::Ok; }
+        if (s == ":sched") {
+            string st = scripted::sched::queryStats();
+            std::cout << (st.empty() ? "No scheduler on " + scripted::sched::socketPath() + " (plugins run unscheduled)\n" : st);
+            return Exec::Ok;
+        }
+
+        // tokenized commands
+        std::istringstream is(s); std::vector<string> tok;
+        for (string t; is >> t;) tok.push_back(t);
+        if (tok.empty()) return Exec::Ok;
+
+        if (tok[0] == ":open" && tok.size() >= 2) {
+            string status; if (openCtx(cfg, ws, tok[1], status)) {
+                string token = (tok[1][0] == cfg.prefix) ? tok[1].substr(1) : tok[1];
+                long long id; parseIntBase(token, cfg.base, id);
+                current = id;
             }
+            std::cout << status << "\n"; return Exec::Ok;
+        }
+
+        if (tok[0] == ":switch" && tok.size() >= 2) {
+            string name = tok[1]; if (name.size() > 4 && name.ends_with(".txt")) name = name.substr(0, name.size() - 4);
+            string token = (name[0] == cfg.prefix) ? name.substr(1) : name;
+            long long id; if (!parseIntBase(token, cfg.base, id)) { std::cout << "Bad id\n"; return Exec::Ok; }
+            string err;
+            bool thawed;
+            { std::lock_guard lk(ws.mu); thawed = ws.banks.count(id) || thawBank(ws, id, err); }
+            if (!thawed) {
+                if (!err.empty()) { error(err); return Exec::Ok; }
+                string status; if (!openCtx(cfg, ws, name, status)) { std::cout << status << "\n"; return Exec::Ok; }
+            }
+            current = id; std::cout << "Switched to " << name << "\n"; return Exec::Ok;
+        }
 
-            std::cout << "Unknown command. :help\n";
+        if (tok[0] == ":ins" && tok.size() >= 3) {
+            string value; for (size_t i = 2; i < tok.size(); ++i) { if (i > 2) value.push_back(' '); value += tok[i]; }
+            insert(tok[1], value); return Exec::Ok;
+        }
+        if (tok[0] == ":insr" && tok.size() >= 4) {
+            string value; for (size_t i = 3; i < tok.size(); ++i) { if (i > 3) value.push_back(' '); value += tok[i]; }
+            insertR(tok[1], tok[2], value); return Exec::Ok;
+        }
+        if (tok[0] == ":del" && tok.size() >= 2) { del(tok[1]); return Exec::Ok; }
+        if (tok[0] == ":delr" && tok.size() >= 3) { delR(tok[1], tok[2]); return Exec::Ok; }
+        if (tok[0] == ":r" && tok.size() >= 2) { readMerge(tok[1]); return Exec::Ok; }
+        if (tok[0] == ":set") { set(tok); return Exec::Ok; }
+
+        // NEW: plugin run
+        if (tok[0] == ":plugin_run" && tok.size() >= 4 && tok[3].find("..") != string::npos) {
+            if (!ensureCurrent()) { std::cout << "Open a context first\n"; return Exec::Ok; }
+            pluginRunRange(tok); return Exec::Ok;
+        }
+        if (tok[0] == ":plugin_show" && tok.size() >= 4) {
+            if (!ensureCurrent()) { std::cout << "Open a context first\n"; return Exec::Ok; }
+            pluginShow(tok); return Exec::Ok;
+        }
+        if (tok[0] == ":mem") { memCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":profile") { profileCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":cold") { coldCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":types" || tok[0] == ":type") { typeCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":agg") { aggCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":mget" && tok.size() >= 2) { mgetCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":peek" && tok.size() == 4) { peek(tok); return Exec::Ok; }
+        if (tok[0] == ":resolve") { resolveOut(tok); return Exec::Ok; }
+        if (tok[0] == ":explain") { explain(tok); return Exec::Ok; }
+        if (tok[0] == ":foreach") { foreachCmd(s); return Exec::Ok; }
+        if (tok[0] == ":farm") { farmCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":bg") { bgCmd(s); return Exec::Ok; }
+        if (tok[0] == ":jobs") { jobsCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":check") return checkCmd(tok) ? Exec::Ok : Exec::Failed;
+        if (tok[0] == ":artifacts") { artifactsCmd(tok); return Exec::Ok; }
+        if (tok[0] == ":plugin_run" && tok.size() >= 4) {
+            if (!ensureCurrent()) { std::cout << "Open a context first\n"; return Exec::Ok; }
+            long long r = 0, a = 0;
+            if (!parseIntBase(tok[2], cfg.base, r) || !parseIntBase(tok[3], cfg.base, a)) { std::cout << "Bad reg/addr\n"; return Exec::Ok; }
+            string stdinArg = (tok.size() >= 5 ? tok[4] : string("{}"));
+            string out_json, report;
+            bool ok = kernel().run(tok[1], *current, r, a, stdinArg, out_json, report);
+            if (!ok) error(report);
+            else {
+                std::cout << "output.json:\n" << out_json << "\n";
+                if (!report.empty()) std::cout << report;
+            }
+            return Exec::Ok;
+        }
+
+        std::cout << "Unknown command. :help\n";
+        return Exec::Unknown;
+    }
+
+    void banner() {
+        std::cout << "scripted CLI — shared core\nType :help for commands.\n\n";
+        std::cout << "scripted CLI — " << scripted::platformName() << (scripted::isWSL() ? " (WSL)" : "") << "\n";
+    }
+
+    void repl() {
+        string line;
+        while (true) {
+            std::cout << ">> ";
+            if (!std::getline(std::cin, line)) break;
+            if (execute(line) != Exec::Quit) continue;
+            if (!dirty) break;
+            std::cout << "Unsaved changes. Type :w to save or :q again to quit.\n>> ";
+            string l2; if (!std::getline(std::cin, l2)) break;
+            if (trim(l2) == ":q") break;
+            (void)execute(l2);
         }
         std::cout << "bye.\n";
     }
 };
 
-int main() {
+// --replay: runs a recording's commands in a scratch copy of its workspace snapshot
+// and compares wall time and result per command. 0: nothing slower or different,
+// 1: regressions, 2: could not replay.
+struct ReplayOptions {
+    double speed = 1;          // pauses between commands divided by this; 0 = none (--speed max)
+    double tolerancePct = 20;
+    bool   keep = false;       // leave the scratch workspace in place
+};
+
+static int replaySession(Editor& ed, const fs::path& file, const ReplayOptions& opt) {
+    using clock = std::chrono::steady_clock;
+    replay::Session rec; string err;
+    const fs::path origin = fs::current_path();
+    const fs::path recording = fs::absolute(file);
+    if (!replay::load(recording, rec, err)) { std::cerr << "replay: " << err << "\n"; return 2; }
+
+    fs::path snap = replay::snapshotDir(recording) / "files";
+    if (!fs::is_directory(snap)) {
+        std::cerr << "replay: no snapshot " << snap.string() << "; replaying against ./files\n";
+        snap = origin / ed.P.root;
+    }
+    std::error_code ec;
+    const fs::path scratch = fs::temp_directory_path(ec) /
+        ("scripted-replay-" + std::to_string(clock::now().time_since_epoch().count()));
+    if (!replay::copyWorkspace(snap, scratch / "files", err)) { std::cerr << "replay: " << err << "\n"; return 2; }
+    if (fs::is_directory(origin / "plugins"))
+        fs::copy(origin / "plugins", scratch / "plugins", fs::copy_options::recursive, ec);
+
+    replay::Report rep;
+    rep.fingerprint = replay::fingerprint(scratch / "files");
+    rep.fingerprintMatches = rep.fingerprint == rec.header["fingerprint"];
+    std::cout << "Replaying " << rec.entries.size() << " command(s) from " << file.string() << " (recorded on "
+              << rec.header["platform"] << ", " << rec.header["cores"] << " cores) in " << scratch.string() << "\n";
+    if (!rep.fingerprintMatches)
+        std::cout << "warning: workspace " << rep.fingerprint << " differs from the recorded " << rec.header["fingerprint"] << "\n";
+
+    fs::current_path(scratch);
+    ed.P.ensure();
+    ed.loadConfig(false);
+    RoutedCout::install();
+    string log;
+    const replay::Entry* prev = nullptr;
+    for (auto& e : rec.entries) {
+        // The user's think time between commands, as recorded.
+        if (prev && opt.speed > 0) {
+            double gap = e.atMs - (prev->atMs + prev->ms);
+            if (gap > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(gap / opt.speed));
+        }
+        prev = &e;
+        RoutedCout::Sink out;
+        RoutedCout::sink = &out;
+        auto t0 = clock::now();
+        Editor::Exec r = ed.execute(e.command);
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        RoutedCout::sink = nullptr;
+        rep.rows.push_back({e, ms, Editor::execName(r)});
+        log += "## [" + std::to_string(rep.rows.size()) + "] " + e.command + "\n" + out.text;
+    }
+    ed.stopJobs();
+    fs::current_path(origin);
+    if (!opt.keep) fs::remove_all(scratch, ec);
+
+    replay::judge(rep, opt.tolerancePct);
+    fs::path base = recording; base += ".replay";
+    fs::path tsv = base; tsv += ".tsv";
+    fs::path outLog = base; outLog += ".log";
+    if (!writeFileAtomic(tsv, replay::toTSV(rep), err) || !writeFileAtomic(outLog, log, err))
+        std::cerr << "replay: " << err << "\n";
+
+    // Largest changes first; all of them are in the .tsv.
+    std::vector<const replay::Row*> order;
+    for (auto& row : rep.rows) order.push_back(&row);
+    std::stable_sort(order.begin(), order.end(), [](auto* a, auto* b) {
+        return std::abs(a->ms - a->recorded.ms) > std::abs(b->ms - b->recorded.ms);
+    });
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    os << "  recorded ms   replay ms     delta\n";
+    for (size_t i = 0; i < order.size() && i < 20; ++i) {
+        auto& row = *order[i];
+        os << std::setw(13) << row.recorded.ms << std::setw(12) << row.ms << std::showpos << std::setw(10)
+           << row.ms - row.recorded.ms << std::noshowpos << (row.slower ? " SLOWER " : "        ")
+           << (row.result != row.recorded.result ? "[" + row.recorded.result + " -> " + row.result + "] " : string())
+           << row.recorded.command << "\n";
+    }
+    if (order.size() > 20) os << "  ... " << order.size() - 20 << " more\n";
+    os << "Total " << rep.recordedMs << " ms recorded, " << rep.replayMs << " ms replayed ("
+       << std::showpos << (rep.recordedMs > 0 ? (rep.replayMs / rep.recordedMs - 1) * 100 : 0.0) << std::noshowpos
+       << "%); " << rep.slower << " slower than +" << opt.tolerancePct << "%, " << rep.mismatched << " with a different result\n"
+       << "Wrote " << tsv.string() << " and " << outLog.string() << "\n";
+    std::cout << os.str();
+    return rep.slower || rep.mismatched ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
     Editor ed;
+    bool schedServer = false;
+    int slots = 0; long long jobMemMB = 512;
+    std::map<string, int> schedWeights;   // --weight user=N
+    std::vector<string> commands; // -c, run in order, then exit
+    string recordTo, replayFrom;
+    ReplayOptions replayOpt;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--strict") ed.utf8Override = Utf8Policy::Strict;
+        else if (a == "--repair") ed.utf8Override = Utf8Policy::Repair;
+        else if (a == "--sched-server") schedServer = true;
+        else if (a == "--slots" && i + 1 < argc) slots = std::atoi(argv[++i]);
+        else if (a == "--job-mem" && i + 1 < argc) jobMemMB = std::atoll(argv[++i]);
+        else if (a == "--weight" && i + 1 < argc) {
+            string v = argv[++i];
+            auto eq = v.find('=');
+            int w = eq == string::npos ? 0 : std::atoi(v.c_str() + eq + 1);
+            if (eq == 0 || w < 1) { std::cerr << "--weight takes user=N with N >= 1, not '" << v << "'\n"; return 2; }
+            schedWeights[v.substr(0, eq)] = w;
+        }
+        else if (a == "-c" && i + 1 < argc) commands.push_back(argv[++i]);
+        else if (a == "--startup-profile") ed.prof.on = true;
+        else if (a == "--record" && i + 1 < argc) recordTo = argv[++i];
+        else if (a == "--replay" && i + 1 < argc) replayFrom = argv[++i];
+        else if (a == "--speed" && i + 1 < argc) {
+            string v = argv[++i];
+            char* end = nullptr;
+            replayOpt.speed = v == "max" ? 0 : std::strtod(v.c_str(), &end);
+            if (v != "max" && (end == v.c_str() || *end || !(replayOpt.speed > 0))) {
+                std::cerr << "--speed takes max or a positive factor, not '" << v << "'\n";
+                return 2;
+            }
+        }
+        else if (a == "--tolerance" && i + 1 < argc) replayOpt.tolerancePct = std::atof(argv[++i]);
+        else if (a == "--keep") replayOpt.keep = true;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--strict|--repair] [--startup-profile] [--record <file>] [-c ':cmd']...\n"
+                      << "       " << argv[0] << " --replay <file> [--speed max|<factor>] [--tolerance <pct>] [--keep]\n"
+                      << "       " << argv[0] << " --sched-server [--slots N] [--job-mem MB] [--weight user=N]...\n";
+            return 2;
+        }
+    }
+    if (schedServer) {
+#if !defined(_WIN32)
+        return scripted::sched::Server(scripted::sched::socketPath(),
+                                       slots > 0 ? slots : scripted::sched::defaultSlots(jobMemMB),
+                                       std::move(schedWeights)).run();
+#else
+        std::cerr << "--sched-server is not available on Windows\n";
+        return 2;
+#endif
+    }
+    if (!replayFrom.empty()) return replaySession(ed, replayFrom, replayOpt);
+    const bool oneShot = !commands.empty();
+    if (oneShot) {
+        // Nothing reads stdin interactively, so skip C stdio sync and the cin->cout flush.
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+    }
+    ed.prof.mark("args");
+    ed.P.ensure();
+    ed.prof.mark("paths");
+    ed.loadConfig(!oneShot);
+    ed.prof.mark("config");
+    if (!recordTo.empty()) {
+        string err;
+        ed.recorder = std::make_unique<replay::Recorder>();
+        if (!ed.recorder->open(recordTo, ed.P, err)) { std::cerr << "record: " << err << "\n"; return 2; }
+        ed.prof.mark("record snapshot");
+    }
+
+    if (oneShot) {
+        int rc = 0;
+        for (auto& c : commands) {
+            auto r = ed.execute(c);
+            ed.prof.mark("cmd " + trim(c).substr(0, trim(c).find(' ')));
+            if (r == Editor::Exec::Unknown || r == Editor::Exec::Failed) rc = 1;
+            if (r == Editor::Exec::Quit) break;
+        }
+        ed.stopJobs();
+        if (ed.dirty) std::cerr << "warning: unsaved changes discarded (add -c ':w')\n";
+        std::cout.flush();
+        ed.prof.print();
+        return rc;
+    }
+    ed.banner();
+    ed.prof.mark("banner");
+    ed.prof.print();
     ed.repl();
+    ed.stopJobs();
     return 0;
 }
@@ -0,0 +1,281 @@
+// scripted_bench.cpp — thread-scaling harness for the core (build.ps1 -Bench)
+// C++23. Builds on its own next to scripted.cpp: g++ -std=c++23 -O2 scripted_bench.cpp -o bench-threads
+//
+// Runs each operation at 1, 2, 4 ... N threads for a fixed time per level over a
+// synthetic workspace in a temp directory, and reports throughput, speedup over
+// one thread, parallel efficiency (speedup / threads) and latency percentiles:
+//   parse    parseBankText over in-memory bank texts (allocator)
+//   resolve  resolveBankToText of one bank, each thread on its own Workspace
+//   kernel   Kernel::run of a no-op plugin, one shared Kernel (filesystem, spawning)
+// JSON goes to --json (default bench-threads.json), a text chart to stdout.
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <set>
+#include <thread>
+#include "scripted_core.hpp"
+#include "scripted_kernel.hpp"
+
+using namespace scripted;
+
+namespace {
+
+struct Level {
+    int threads = 1;
+    uint64_t ops = 0, failed = 0;
+    double seconds = 0, throughput = 0, speedup = 0, efficiency = 0;
+    double p50us = 0, p90us = 0, p99us = 0, maxUs = 0;
+};
+struct Bench {
+    string name;
+    std::vector<Level> levels;
+};
+
+// One operation on thread `t`, call number `i`; false counts as failed.
+using Op = std::function<bool(int t, uint64_t i)>;
+
+Level runLevel(int threads, std::chrono::milliseconds span, const Op& op) {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::vector<uint32_t>> lat(static_cast<size_t>(threads));   // ns, saturated at ~4 s
+    std::vector<uint64_t> failed(size_t(threads), 0);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    clock::time_point start, stop;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t)
+        pool.emplace_back([&, t] {
+            auto& mine = lat[size_t(t)];
+            mine.reserve(1 << 16);
+            ++ready;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (uint64_t i = 0; clock::now() < stop; ++i) {
+                auto t0 = clock::now();
+                if (!op(t, i)) ++failed[size_t(t)];
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+                mine.push_back(uint32_t(std::min<long long>(ns, std::numeric_limits<uint32_t>::max())));
+            }
+        });
+    while (ready.load() < threads) std::this_thread::yield();
+    start = clock::now();
+    stop = start + span;
+    go.store(true, std::memory_order_release);
+    for (auto& th : pool) th.join();
+    double secs = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    for (auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, size_t(p * double(all.size())))] / 1000.0; };
+    Level L;
+    L.threads = threads;
+    L.ops = all.size();
+    for (auto f : failed) L.failed += f;
+    L.seconds = secs;
+    L.throughput = double(L.ops) / secs;
+    L.p50us = pct(0.50); L.p90us = pct(0.90); L.p99us = pct(0.99);
+    L.maxUs = all.empty() ? 0 : all.back() / 1000.0;
+    return L;
+}
+
+Bench runBench(const string& name, const std::vector<int>& threads, std::chrono::milliseconds span, const Op& op) {
+    Bench b{name, {}};
+    std::cerr << "[bench] " << name << ":";
+    for (int n : threads) {
+        std::cerr << " " << n << std::flush;
+        b.levels.push_back(runLevel(n, span, op));
+    }
+    std::cerr << "\n";
+    double base = b.levels.empty() ? 0 : b.levels[0].throughput / b.levels[0].threads;
+    for (auto& L : b.levels) {
+        L.speedup = base > 0 ? L.throughput / base : 0;
+        L.efficiency = L.speedup / L.threads;
+    }
+    return b;
+}
+
+// ---- synthetic workspace ----
+constexpr int kBanks = 32, kCells = 200, kKernelCells = 4096;
+
+string bankName(const Config& cfg, long long id) { return string(1, cfg.prefix) + toBaseN(id, cfg.base, cfg.widthBank); }
+
+// Register 1 holds text citing two leaf cells (register 2) of other banks, so a
+// resolve is one level deep and its cost stays linear in the bank size.
+string makeBank(const Config& cfg, int id) {
+    std::ostringstream os;
+    os << bankName(cfg, id) << "\t(bench bank " << id << "){\n";
+    os << toBaseN(1, cfg.base, cfg.widthReg) << "\n";
+    for (int a = 1; a <= kCells; ++a) {
+        int b1 = 1 + (id + a) % kBanks, b2 = 1 + (id * 7 + a * 3) % kBanks;
+        os << "\t" << toBaseN(a, cfg.base, cfg.widthAddr) << "\tcell " << a << " of " << id << " joins "
+           << bankName(cfg, b1) << "." << toBaseN(2, cfg.base, cfg.widthReg) << "." << toBaseN(a, cfg.base, cfg.widthAddr)
+           << " with " << bankName(cfg, b2) << "." << toBaseN(2, cfg.base, cfg.widthReg) << "."
+           << toBaseN(1 + (a * 13) % kCells, cfg.base, cfg.widthAddr) << " for the report\n";
+    }
+    os << toBaseN(2, cfg.base, cfg.widthReg) << "\n";
+    for (int a = 1; a <= kCells; ++a)
+        os << "\t" << toBaseN(a, cfg.base, cfg.widthAddr) << "\tleaf value " << id << "/" << a << " lorem ipsum dolor\n";
+    os << "}\n";
+    return os.str();
+}
+
+bool writeSandbox(const Config& cfg, std::vector<string>& texts, string& err) {
+    Paths P;
+    P.ensure();
+    for (int id = 1; id <= kBanks; ++id) {
+        texts.push_back(makeBank(cfg, id));
+        if (!writeFileAtomic(contextFileName(cfg, id), texts.back(), err)) return false;
+    }
+    std::ostringstream os;
+    os << bankName(cfg, kBanks + 1) << "\t(kernel cells){\n";
+    for (int a = 1; a <= kKernelCells; ++a) os << "\t" << toBaseN(a, cfg.base, cfg.widthAddr) << "\tnoop " << a << "\n";
+    os << "}\n";
+    if (!writeFileAtomic(contextFileName(cfg, kBanks + 1), os.str(), err)) return false;
+
+    // No-op plugin: writes {"ok":true} and exits.
+    fs::create_directories("plugins/noop");
+    bool ok = writeFileAtomic("plugins/noop/plugin.json",
+                              "{ \"name\": \"noop\", \"entry_win\": \"run.bat\", \"entry_lin\": \"run.sh\" }\n", err) &&
+              writeFileAtomic("plugins/noop/run.sh", "#!/bin/sh\nprintf '{\"ok\":true}' > \"$2/output.json\"\n", err) &&
+              writeFileAtomic("plugins/noop/run.bat", "@echo off\r\necho {\"ok\":true}> \"%~2\\output.json\"\r\n", err);
+    if (!ok) return false;
+    std::error_code ec;
+    fs::permissions("plugins/noop/run.sh", fs::perms::owner_all | fs::perms::group_read | fs::perms::others_read, ec);
+    return true;
+}
+
+// ---- reporting ----
+string toJSON(const std::vector<Bench>& benches, unsigned cores, long long ms) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "{\n  \"cores\": " << cores << ",\n  \"ms_per_level\": " << ms << ",\n  \"benchmarks\": [";
+    for (size_t b = 0; b < benches.size(); ++b) {
+        os << (b ? "," : "") << "\n    {\"name\": \"" << jsonEscape(benches[b].name) << "\", \"levels\": [";
+        for (size_t k = 0; k < benches[b].levels.size(); ++k) {
+            const Level& L = benches[b].levels[k];
+            os << (k ? "," : "") << "\n      {\"threads\": " << L.threads << ", \"ops\": " << L.ops << ", \"failed\": " << L.failed
+               << ", \"seconds\": " << L.seconds << ", \"ops_per_sec\": " << L.throughput << ", \"speedup\": " << L.speedup
+               << ", \"efficiency\": " << L.efficiency << ", \"p50_us\": " << L.p50us << ", \"p90_us\": " << L.p90us
+               << ", \"p99_us\": " << L.p99us << ", \"max_us\": " << L.maxUs << "}";
+        }
+        os << "\n    ]}";
+    }
+    os << "\n  ]\n}\n";
+    return os.str();
+}
+
+// Speedup as a bar against the ideal (one '#' per 1/40 of `threads`x).
+string chart(const std::vector<Bench>& benches) {
+    std::ostringstream os;
+    os << std::fixed;
+    for (auto& b : benches) {
+        os << "\n" << b.name << "\n";
+        os << std::right << std::setw(8) << "threads" << std::setw(14) << "ops/s" << std::setw(9) << "speedup"
+           << std::setw(6) << "eff" << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << "  scaling (| = ideal)\n";
+        for (auto& L : b.levels) {
+            const int width = 40;
+            int bar = int(std::lround(std::clamp(L.efficiency, 0.0, 1.5) * width));
+            string viz = string(size_t(std::min(bar, width)), '#');
+            if (viz.size() < size_t(width)) viz += string(size_t(width) - viz.size(), ' ');
+            viz += '|';
+            if (bar > width) viz += string(size_t(bar - width), '#');
+            os << std::setw(8) << L.threads << std::setw(14) << std::setprecision(0) << L.throughput
+               << std::setw(8) << std::setprecision(2) << L.speedup << "x" << std::setw(5) << std::setprecision(0)
+               << L.efficiency * 100 << "%" << std::setw(11) << std::setprecision(1) << L.p50us << std::setw(11) << L.p99us
+               << "  " << viz << (L.failed ? "  (" + std::to_string(L.failed) + " failed)" : string()) << "\n";
+        }
+    }
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threads;
+    long long ms = 1000;
+    std::set<string> only;
+    fs::path jsonOut = "bench-threads.json";
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) {
+            std::istringstream is(argv[++i]);
+            for (string t; std::getline(is, t, ','); ) { long long n; if (parseIntBase(t, 10, n) && n > 0) threads.push_back(int(n)); }
+        }
+        else if (a == "--ms" && i + 1 < argc) ms = std::max(50LL, std::atoll(argv[++i]));
+        else if (a == "--only" && i + 1 < argc) {
+            std::istringstream is(argv[++i]);
+            for (string t; std::getline(is, t, ','); ) only.insert(t);
+        }
+        else if (a == "--json" && i + 1 < argc) jsonOut = argv[++i];
+        else if (a == "--keep") keep = true;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--threads 1,2,4,...] [--ms per-level] [--only parse,resolve,kernel]"
+                      << " [--json file] [--keep]\n";
+            return 2;
+        }
+    }
+    if (threads.empty()) {
+        for (unsigned n = 1; n < cores; n *= 2) threads.push_back(int(n));
+        threads.push_back(int(cores));
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    auto want = [&](const char* n) { return only.empty() || only.count(n); };
+    jsonOut = fs::absolute(jsonOut);
+
+    // Everything below runs inside the sandbox directory; every return leaves it
+    // and (without --keep) removes it.
+    struct Sandbox {
+        fs::path home = fs::current_path(), box;
+        bool keep;
+        Sandbox(fs::path b, bool k) : box(std::move(b)), keep(k) { fs::create_directories(box); fs::current_path(box); }
+        ~Sandbox() {
+            std::error_code ec;
+            fs::current_path(home, ec);
+            if (!keep) fs::remove_all(box, ec);
+        }
+    } sandbox(fs::temp_directory_path() / ("scripted-bench-" + std::to_string(kernel::processId())), keep);
+    const fs::path& box = sandbox.box;
+    Config cfg;
+    std::vector<string> texts;
+    string err;
+    if (!writeSandbox(cfg, texts, err)) { std::cerr << "sandbox: " << err << "\n"; return 1; }
+    std::cerr << "[bench] sandbox " << box.string() << ", " << cores << " cores, " << ms << " ms per level\n";
+    const auto span = std::chrono::milliseconds(ms);
+    const int maxThreads = threads.back();
+
+    std::vector<Bench> benches;
+    if (want("parse"))
+        benches.push_back(runBench("parse", threads, span, [&](int t, uint64_t i) {
+            Bank b;
+            return parseBankText(texts[(size_t(t) * 7 + i) % texts.size()], cfg, b).ok;
+        }));
+    if (want("resolve")) {
+        std::vector<std::unique_ptr<Workspace>> copies;
+        for (int t = 0; t < maxThreads; ++t) {
+            copies.push_back(std::make_unique<Workspace>());
+            (void)preloadAll(cfg, *copies.back());
+        }
+        benches.push_back(runBench("resolve", threads, span, [&](int t, uint64_t i) {
+            string text;
+            return resolveBankToText(cfg, *copies[size_t(t)], 1 + static_cast<long long>((size_t(t) * 7 + i) % kBanks), text) && !text.empty();
+        }));
+    }
+    if (want("kernel")) {
+        Workspace ws;
+        kernel::Kernel K(cfg, ws);
+        if (!K.find("noop")) { std::cerr << "kernel: noop plugin not discovered\n"; return 1; }
+        std::atomic<uint64_t> seq{0};
+        benches.push_back(runBench("kernel", threads, span, [&](int, uint64_t) {
+            string out, report;
+            long long addr = 1 + static_cast<long long>(seq.fetch_add(1) % kKernelCells);   // distinct cells: no coalescing
+            return K.run("noop", kBanks + 1, 1, addr, "{}", out, report);
+        }));
+    }
+
+    string json = toJSON(benches, cores, ms);
+    if (!writeFileAtomic(jsonOut, json, err)) std::cerr << "json: " << err << "\n";
+    std::cout << chart(benches) << "\nWrote " << jsonOut.string() << "\n";
+    return 0;
+}
@@ -0,0 +1,325 @@
+// scripted_check.hpp — workspace validation pass (`:check`)
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// Parses every selected bank file on up to N threads of the shared executor
+// (scripted_pool.hpp) without building Banks or resolving anything, and reports:
+//   parse         syntax errors with file:line (all of them: a bad body line is
+//                 blanked and the file parsed again, up to kMaxParseErrors)
+//   badref        tokens the resolver would print as [BadRef ...]
+//   dangling      references to a bank or cell that does not exist
+//   missing-file  @file(...) includes with no file under files/
+//   cycle         cells that reach themselves (strongly connected components of
+//                 the reference graph), which the resolver prints as [Circular Ref ...]
+// References are found with the resolver's own patterns, in its order, on the raw
+// value; a matched token is blanked so later patterns skip it, as substitution would.
+#pragma once
+#include "scripted_core.hpp"
+#include "scripted_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scripted {
+namespace check {
+
+using std::string;
+
+struct Issue {
+    string kind;    // parse, badref, dangling, missing-file, cycle
+    string where;   // file:line or cell
+    string what;
+};
+
+struct Options {
+    int jobs = 1;
+    std::vector<std::pair<long long, fs::path>> banks;  // bank files, sorted by id
+};
+
+struct Report {
+    size_t banks = 0, cells = 0, refs = 0, unparsable = 0;
+    std::map<string, size_t> counts;   // kind -> issues
+    std::vector<Issue> issues;         // in bank order, then dangling, then cycles
+    double wallSec = 0;
+    bool cancelled = false;
+};
+
+inline constexpr int kMaxParseErrors = 100;
+
+inline string cellName(const Config& cfg, const CellKey& k) {
+    return string(1, cfg.prefix) + toBaseN(k.bank, cfg.base, cfg.widthBank) + "." +
+           toBaseN(k.reg, cfg.base, cfg.widthReg) + "." + toBaseN(k.addr, cfg.base, cfg.widthAddr);
+}
+
+// Static counterpart of Resolver::resolve: the same passes over one raw value.
+struct RefScanner {
+    struct Ref {
+        enum Kind { Cell, Bad, File } kind;
+        CellKey to;
+        string token;
+    };
+    const Config& cfg;
+    std::regex pref3;
+    explicit RefScanner(const Config& c)
+        : cfg(c), pref3(string(1, c.prefix) + R"(([0-9A-Za-z]+)\.([0-9A-Za-z]+)\.([0-9A-Za-z]+))") {}
+
+    void scan(long long bank, const string& value, std::vector<Ref>& out) const {
+        if (value.find('.') == string::npos && value.find('@') == string::npos) return;
+        static const std::regex fileRe(R"(@file\(([^)]+)\))");
+        static const std::regex same(R"(r([0-9A-Za-z]+)\.([0-9A-Za-z]+))");
+        static const std::regex two(R"(([A-Za-z])([0-9A-Za-z]+)\.([0-9A-Za-z]+)(?!\.))");
+        static const std::regex tri(R"((\d+)\.(\d+)\.(\d+))");
+        string s = value;
+        // Calls fn per match; spans it returns true for are blanked afterwards.
+        auto each = [&](const std::regex& re, auto&& fn) {
+            std::vector<std::pair<size_t, size_t>> hits;
+            for (std::sregex_iterator it(s.cbegin(), s.cend(), re), e; it != e; ++it)
+                if (fn(*it)) hits.emplace_back(size_t(it->position(0)), size_t(it->length(0)));
+            for (auto [p, l] : hits) std::fill_n(s.begin() + p, l, '\x01');
+        };
+        auto num = [&](const string& t, int base, long long& v) { return parseIntBase(t, base, v); };
+        each(fileRe, [&](const std::smatch& m) { out.push_back({Ref::File, {}, trim(m[1].str())}); return true; });
+        each(same, [&](const std::smatch& m) {
+            long long r, a;
+            if (!num(m[1].str(), cfg.base, r) || !num(m[2].str(), cfg.base, a)) out.push_back({Ref::Bad, {}, m[0].str()});
+            else out.push_back({Ref::Cell, {bank, r, a}, m[0].str()});
+            return true;
+        });
+        each(pref3, [&](const std::smatch& m) {
+            long long b, r, a;
+            if (!num(m[1].str(), cfg.base, b) || !num(m[2].str(), cfg.base, r) || !num(m[3].str(), cfg.base, a)) return false;
+            out.push_back({Ref::Cell, {b, r, a}, m[0].str()});
+            return true;
+        });
+        each(two, [&](const std::smatch& m) {
+            if (m[1].str()[0] != cfg.prefix) return false;
+            long long b, a;
+            if (!num(m[2].str(), cfg.base, b) || !num(m[3].str(), cfg.base, a)) out.push_back({Ref::Bad, {}, m[0].str()});
+            else out.push_back({Ref::Cell, {b, 1, a}, m[0].str()});
+            return true;
+        });
+        each(tri, [&](const std::smatch& m) {
+            size_t pos = size_t(m.position(0));
+            if (pos > 0 && std::isalnum(static_cast<unsigned char>(s[pos - 1]))) return false;
+            long long b, r, a;
+            if (!num(m[1].str(), 10, b) || !num(m[2].str(), 10, r) || !num(m[3].str(), 10, a)) out.push_back({Ref::Bad, {}, m[0].str()});
+            else out.push_back({Ref::Cell, {b, r, a}, m[0].str()});
+            return true;
+        });
+    }
+};
+
+namespace detail {
+struct Edge { CellKey from, to; string token; };
+
+struct BankScan {
+    bool ok = false;                                      // parsed without errors
+    std::vector<std::pair<long long, long long>> keys;   // (reg, addr), sorted
+    std::vector<Edge> edges;
+    std::vector<Issue> issues;
+    size_t cells = 0;
+};
+
+// Empties line `n` (1-based) of `text`, keeping the line break.
+inline bool blankLine(string& text, size_t n) {
+    size_t p = 0;
+    for (size_t i = 1; i < n; ++i) {
+        p = text.find('\n', p);
+        if (p == string::npos) return false;
+        ++p;
+    }
+    size_t e = text.find('\n', p);
+    if (e == string::npos) e = text.size();
+    if (e == p) return false;
+    text.erase(p, e - p);
+    return true;
+}
+
+template <class FileExists>
+inline void scanBank(const Config& cfg, const RefScanner& rs, long long id, const fs::path& file,
+                     FileExists&& fileExists, BankScan& out) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) { out.issues.push_back({"parse", file.string(), "cannot open"}); return; }
+    string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    // The header ends on the first line with '{'; errors there cannot be skipped.
+    size_t brace = text.find('{');
+    size_t headerEnd = brace == string::npos ? string::npos : 1 + size_t(std::count(text.begin(), text.begin() + brace, '\n'));
+
+    std::vector<RefScanner::Ref> refs;
+    ParseResult pr;
+    for (int tries = 0; ; ++tries) {
+        out.keys.clear(); out.edges.clear(); out.cells = 0;
+        std::vector<Issue> cellIssues;
+        pr = parseBankStream(text, cfg, [](long long, string&&) {},
+            [&](long long r, long long a, string&& v) {
+                out.keys.emplace_back(r, a);
+                refs.clear();
+                rs.scan(id, v, refs);
+                CellKey from{id, r, a};
+                for (auto& ref : refs) {
+                    if (ref.kind == RefScanner::Ref::Cell) out.edges.push_back({from, ref.to, std::move(ref.token)});
+                    else if (ref.kind == RefScanner::Ref::Bad) cellIssues.push_back({"badref", cellName(cfg, from), ref.token});
+                    else if (!fileExists(ref.token))
+                        cellIssues.push_back({"missing-file", cellName(cfg, from), "@file(" + ref.token + ")"});
+                }
+            });
+        if (pr.ok) { out.issues.insert(out.issues.end(), cellIssues.begin(), cellIssues.end()); break; }
+        out.issues.push_back({"parse", file.string() + (pr.line ? ":" + std::to_string(pr.line) : string()), pr.err});
+        if (pr.line <= headerEnd || tries + 1 >= kMaxParseErrors || !blankLine(text, pr.line)) {
+            out.keys.clear(); out.edges.clear();
+            return;
+        }
+    }
+    // Declared register types are enforced after the scan; only typed banks pay for a full parse.
+    bool typed = std::any_of(pr.types.begin(), pr.types.end(), [](auto& t) { return t.second.type != ColType::Text; });
+    if (typed) {
+        Bank b;
+        ParseResult full = parseBankText(text, cfg, b);
+        if (!full.ok) out.issues.push_back({"parse", file.string(), full.err});
+    }
+    std::sort(out.keys.begin(), out.keys.end());
+    out.keys.erase(std::unique(out.keys.begin(), out.keys.end()), out.keys.end());
+    out.cells = out.keys.size();
+    // A bank with skipped lines still has its own refs checked, but it would not
+    // load, so refs into it are not judged.
+    out.ok = out.issues.empty() || std::none_of(out.issues.begin(), out.issues.end(), [](const Issue& i) { return i.kind == "parse"; });
+}
+
+// Strongly connected components with a cycle (size > 1, or a self-reference),
+// by an iterative Tarjan over the compact graph `adj`.
+inline std::vector<std::vector<uint32_t>> cycles(const std::vector<std::vector<uint32_t>>& adj) {
+    const uint32_t n = uint32_t(adj.size()), none = ~0u;
+    std::vector<uint32_t> index(n, none), low(n, 0), stack;
+    std::vector<char> onStack(n, 0);
+    std::vector<std::pair<uint32_t, size_t>> call;   // (node, next edge)
+    std::vector<std::vector<uint32_t>> found;
+    uint32_t next = 0;
+    for (uint32_t root = 0; root < n; ++root) {
+        if (index[root] != none) continue;
+        call.push_back({root, 0});
+        index[root] = low[root] = next++;
+        stack.push_back(root); onStack[root] = 1;
+        while (!call.empty()) {
+            auto& [v, e] = call.back();
+            if (e < adj[v].size()) {
+                uint32_t w = adj[v][e++];
+                if (index[w] == none) {
+                    index[w] = low[w] = next++;
+                    stack.push_back(w); onStack[w] = 1;
+                    call.push_back({w, 0});
+                } else if (onStack[w]) low[v] = std::min(low[v], index[w]);
+                continue;
+            }
+            uint32_t done = v;
+            call.pop_back();
+            if (!call.empty()) low[call.back().first] = std::min(low[call.back().first], low[done]);
+            if (low[done] != index[done]) continue;
+            std::vector<uint32_t> scc;
+            uint32_t w;
+            do { w = stack.back(); stack.pop_back(); onStack[w] = 0; scc.push_back(w); } while (w != done);
+            bool self = scc.size() == 1 && std::find(adj[done].begin(), adj[done].end(), done) != adj[done].end();
+            if (scc.size() > 1 || self) found.push_back(std::move(scc));
+        }
+    }
+    return found;
+}
+} // namespace detail
+
+inline bool run(const Config& cfg, const CancelToken* cancel, const Options& opt, Report& rep) {
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    rep = Report{};
+    const size_t nb = opt.banks.size();
+    std::vector<detail::BankScan> scans(nb);
+    RefScanner rs(cfg);
+    std::mutex filesMu;
+    std::unordered_map<string, bool> filesSeen;   // @file target -> exists
+    auto fileExists = [&](const string& name) {
+        std::lock_guard lk(filesMu);
+        auto [it, fresh] = filesSeen.try_emplace(name, false);
+        if (fresh) it->second = fs::exists(fs::path("files") / name);
+        return it->second;
+    };
+    pool::shared().parallelFor(nb, size_t(std::max(1, opt.jobs)), [&](size_t i) {
+        if (!cancelled(cancel)) detail::scanBank(cfg, rs, opt.banks[i].first, opt.banks[i].second, fileExists, scans[i]);
+    });
+    if (cancelled(cancel)) { rep.cancelled = true; return false; }
+
+    std::unordered_map<long long, size_t> byId;   // parsed banks only
+    std::vector<Issue> dangling;
+    for (size_t i = 0; i < nb; ++i) {
+        auto& sc = scans[i];
+        ++rep.banks;
+        rep.cells += sc.cells;
+        rep.refs += sc.edges.size();
+        if (sc.ok) byId[opt.banks[i].first] = i;
+        else ++rep.unparsable;
+        rep.issues.insert(rep.issues.end(), sc.issues.begin(), sc.issues.end());
+    }
+    // Dangling targets; edges between existing cells form the graph for cycles.
+    // Refs into a bank that failed to parse are not judged (its parse error is reported).
+    std::unordered_map<CellKey, uint32_t, CellKeyHash> node;
+    std::vector<CellKey> keyOf;
+    std::vector<std::pair<uint32_t, CellKey>> live;
+    auto nodeOf = [&](const CellKey& k) {
+        auto [it, fresh] = node.try_emplace(k, uint32_t(keyOf.size()));
+        if (fresh) keyOf.push_back(k);
+        return it->second;
+    };
+    std::unordered_set<long long> unparsed;
+    for (size_t i = 0; i < nb; ++i) if (!scans[i].ok) unparsed.insert(opt.banks[i].first);
+    for (auto& sc : scans) {
+        for (auto& e : sc.edges) {
+            auto itB = byId.find(e.to.bank);
+            if (itB == byId.end()) {
+                if (!unparsed.count(e.to.bank))
+                    dangling.push_back({"dangling", cellName(cfg, e.from), e.token + " (no bank " + string(1, cfg.prefix) + toBaseN(e.to.bank, cfg.base, cfg.widthBank) + ")"});
+                continue;
+            }
+            auto& keys = scans[itB->second].keys;
+            if (!std::binary_search(keys.begin(), keys.end(), std::make_pair(e.to.reg, e.to.addr))) {
+                dangling.push_back({"dangling", cellName(cfg, e.from), e.token + " (no cell " + cellName(cfg, e.to) + ")"});
+                continue;
+            }
+            live.push_back({nodeOf(e.from), e.to});
+        }
+        sc.edges.clear(); sc.edges.shrink_to_fit();
+    }
+    rep.issues.insert(rep.issues.end(), dangling.begin(), dangling.end());
+
+    // Only cells with outgoing references can sit on a cycle.
+    std::vector<std::vector<uint32_t>> adj(keyOf.size());
+    for (auto& [from, to] : live)
+        if (auto it = node.find(to); it != node.end()) adj[from].push_back(it->second);
+    for (auto& scc : detail::cycles(adj)) {
+        std::vector<CellKey> cells;
+        for (uint32_t v : scc) cells.push_back(keyOf[v]);
+        std::sort(cells.begin(), cells.end(), [](const CellKey& a, const CellKey& b) {
+            return std::tie(a.bank, a.reg, a.addr) < std::tie(b.bank, b.reg, b.addr);
+        });
+        string what = std::to_string(cells.size()) + " cell(s):";
+        for (size_t k = 0; k < cells.size() && k < 10; ++k) what += " " + cellName(cfg, cells[k]);
+        if (cells.size() > 10) what += " ... +" + std::to_string(cells.size() - 10);
+        rep.issues.push_back({"cycle", cellName(cfg, cells[0]), what});
+    }
+    for (auto& is : rep.issues) ++rep.counts[is.kind];
+    rep.wallSec = std::chrono::duration<double>(clock::now() - t0).count();
+    return true;
+}
+
+// One issue per line: kind \t where \t what (tabs and line breaks in `what` become spaces).
+inline string toTSV(const Report& rep) {
+    string out = "kind\twhere\twhat\n";
+    for (auto& is : rep.issues) {
+        string what = is.what;
+        for (char& c : what) if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+        out += is.kind + '\t' + is.where + '\t' + what + '\n';
+    }
+    return out;
+}
+
+} // namespace check
+} // namespace scripted
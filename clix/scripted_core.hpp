@@ -7,6 +7,7 @@
 #include <string_view>
 #include <vector>
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <regex>
@@ -18,6 +19,39 @@
 #include <cctype>
 #include <limits>
 #include <optional>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <atomic>
+#include <csignal>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "scripted_outidx.hpp"
+
+// x86 SIMD paths are compiled with per-function target attributes and picked
+// at runtime, so the binary still runs on CPUs without AVX2.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SCRIPTED_SIMD_X86 1
+    #include <immintrin.h>
+#else
+    #define SCRIPTED_SIMD_X86 0
+#endif
+
+#if defined(__GLIBC__)
+    #include <malloc.h>
+#endif
+#if !defined(_WIN32)
+    #include <unistd.h>
+#else
+    #include <process.h>
+#endif
 
 namespace scripted {
 
@@ -94,6 +128,326 @@ inline string toBaseN(long long val, int base, int width){
     return s;
 }
 
+// ----------------------------- SIMD dispatch -----------------------------
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+inline const char* simdLevelName(SimdLevel l){
+    switch (l){
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE2: return "sse2";
+        default:              return "scalar";
+    }
+}
+// Best level supported by this CPU (detected once).
+inline SimdLevel simdLevel(){
+#if SCRIPTED_SIMD_X86
+    static const SimdLevel lvl = []{
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+    }();
+    return lvl;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// ----------------------------- JSON string escaping -----------------------------
+// Shared by every JSON writer. The vector scanners find the next byte needing an
+// escape ('"', '\\' or < 0x20) 16/32 bytes at a time so clean runs are appended
+// in one go; only the escapes themselves are handled byte by byte.
+namespace detail {
+inline bool jsonNeedsEscape(unsigned char c){ return c < 0x20 || c == '"' || c == '\\'; }
+
+inline const char* jsonScanScalar(const char* p, const char* end){
+    while (p < end && !jsonNeedsEscape(static_cast<unsigned char>(*p))) ++p;
+    return p;
+}
+#if SCRIPTED_SIMD_X86
+__attribute__((target("sse2")))
+inline const char* jsonScanSSE2(const char* p, const char* end){
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctl = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v)); // v <= 0x1F unsigned
+        if (int bits = _mm_movemask_epi8(m)) return p + __builtin_ctz(static_cast<unsigned>(bits));
+    }
+    return jsonScanScalar(p, end);
+}
+__attribute__((target("avx2")))
+inline const char* jsonScanAVX2(const char* p, const char* end){
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i ctl = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32){
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+                                    _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v));
+        if (unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(m))) return p + __builtin_ctz(bits);
+    }
+    return jsonScanSSE2(p, end);
+}
+#endif
+inline const char* jsonScan(const char* p, const char* end, SimdLevel lvl){
+#if SCRIPTED_SIMD_X86
+    if (lvl == SimdLevel::AVX2) return jsonScanAVX2(p, end);
+    if (lvl == SimdLevel::SSE2) return jsonScanSSE2(p, end);
+#endif
+    (void)lvl;
+    return jsonScanScalar(p, end);
+}
+} // namespace detail
+
+inline void jsonEscapeAppend(string& o, std::string_view s, SimdLevel lvl = simdLevel()){
+    const char* p = s.data();
+    const char* end = p + s.size();
+    while (p < end){
+        const char* q = detail::jsonScan(p, end, lvl);
+        o.append(p, q);
+        if (q == end) break;
+        unsigned char c = static_cast<unsigned char>(*q);
+        switch (c) {
+            case '\\': o += "\\\\"; break;
+            case '\"': o += "\\\""; break;
+            case '\b': o += "\\b";  break;
+            case '\f': o += "\\f";  break;
+            case '\n': o += "\\n";  break;
+            case '\r': o += "\\r";  break;
+            case '\t': o += "\\t";  break;
+            default: { char buf[7]; std::snprintf(buf, sizeof(buf), "\\u%04X", c); o += buf; }
+        }
+        p = q + 1;
+    }
+}
+inline string jsonEscape(std::string_view s){
+    string o; o.reserve(s.size() + 8);
+    jsonEscapeAppend(o, s);
+    return o;
+}
+
+// ----------------------------- UTF-8 validation -----------------------------
+// Bank text is validated and CR-normalised once at load. The AVX2 path is the
+// Keiser/Lemire lookup algorithm (three nibble tables + 2/3-continuation check)
+// and also notes any '\r' in the same pass; SSE2 skips ASCII 16 bytes at a time.
+// Errors are rare, so offsets are located afterwards by the scalar decoder.
+enum class Utf8Policy { Strict, Repair };
+
+namespace detail {
+// Length (1..4) of the well-formed sequence at p, or 0 if ill-formed; `bad` then
+// holds the length of the maximal invalid subpart (replaced by one U+FFFD).
+inline size_t utf8SeqLen(const unsigned char* p, const unsigned char* end, size_t& bad){
+    unsigned c = p[0];
+    if (c < 0x80) return 1;
+    size_t need; unsigned lo = 0x80, hi = 0xBF;
+    if      (c >= 0xC2 && c <= 0xDF) need = 1;
+    else if (c == 0xE0)              { need = 2; lo = 0xA0; }
+    else if (c == 0xED)              { need = 2; hi = 0x9F; }
+    else if (c >= 0xE1 && c <= 0xEF) need = 2;
+    else if (c == 0xF0)              { need = 3; lo = 0x90; }
+    else if (c >= 0xF1 && c <= 0xF3) need = 3;
+    else if (c == 0xF4)              { need = 3; hi = 0x8F; }
+    else { bad = 1; return 0; }
+    for (size_t i = 1; i <= need; ++i){
+        if (p + i >= end || p[i] < lo || p[i] > hi) { bad = i; return 0; }
+        lo = 0x80; hi = 0xBF;
+    }
+    return need + 1;
+}
+inline bool utf8ValidateScalar(const unsigned char* p, size_t n, bool& sawCR){
+    const unsigned char* end = p + n;
+    bool ok = true;
+    while (p < end){
+        if (*p < 0x80) { sawCR |= (*p == '\r'); ++p; continue; }
+        size_t bad = 0, len = utf8SeqLen(p, end, bad);
+        if (!len) { ok = false; p += bad; } else p += len;
+    }
+    return ok;
+}
+#if SCRIPTED_SIMD_X86
+__attribute__((target("sse2")))
+inline bool utf8ValidateSSE2(const unsigned char* p, size_t n, bool& sawCR){
+    const unsigned char* end = p + n;
+    const __m128i cr = _mm_set1_epi8('\r');
+    __m128i crAcc = _mm_setzero_si128();
+    bool ok = true;
+    while (p < end){
+        if (end - p >= 16){
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            crAcc = _mm_or_si128(crAcc, _mm_cmpeq_epi8(v, cr));
+            if (!_mm_movemask_epi8(v)) { p += 16; continue; }
+        }
+        if (*p < 0x80) { sawCR |= (*p == '\r'); ++p; continue; }
+        size_t bad = 0, len = utf8SeqLen(p, end, bad);
+        if (!len) { ok = false; p += bad; } else p += len;
+    }
+    sawCR |= _mm_movemask_epi8(crAcc) != 0;
+    return ok;
+}
+__attribute__((target("avx2")))
+inline bool utf8ValidateAVX2(const unsigned char* p, size_t n, bool& sawCR){
+    enum : uint8_t {
+        TOO_SHORT = 1<<0, TOO_LONG = 1<<1, OVERLONG_3 = 1<<2, TOO_LARGE = 1<<3,
+        SURROGATE = 1<<4, OVERLONG_2 = 1<<5, TOO_LARGE_1000 = 1<<6, OVERLONG_4 = 1<<6,
+        TWO_CONTS = 1<<7, CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+    };
+    alignas(16) static const uint8_t kByte1High[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4 };
+    alignas(16) static const uint8_t kByte1Low[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY, CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000 };
+    alignas(16) static const uint8_t kByte2High[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT };
+    const __m256i byte1High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte1High)));
+    const __m256i byte1Low  = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte1Low)));
+    const __m256i byte2High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte2High)));
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    const __m256i cr  = _mm256_set1_epi8('\r');
+    const __m256i incompleteMax = _mm256_setr_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    __m256i err = _mm256_setzero_si256(), prevIncomplete = err, prevInput = err, crAcc = err;
+    alignas(32) unsigned char tail[32];
+    for (size_t i = 0; i < n; i += 32){
+        const unsigned char* blk = p + i;
+        if (n - i < 32) {   // zero padding is ASCII, so it cannot add errors
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, p + i, n - i);
+            blk = tail;
+        }
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blk));
+        crAcc = _mm256_or_si256(crAcc, _mm256_cmpeq_epi8(in, cr));
+        if (!_mm256_movemask_epi8(in)) {
+            err = _mm256_or_si256(err, prevIncomplete);
+            prevIncomplete = _mm256_setzero_si256();
+        } else {
+            __m256i carry = _mm256_permute2x128_si256(prevInput, in, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(in, carry, 15);
+            __m256i prev2 = _mm256_alignr_epi8(in, carry, 14);
+            __m256i prev3 = _mm256_alignr_epi8(in, carry, 13);
+            __m256i sc = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib)),
+                    _mm256_shuffle_epi8(byte1Low,  _mm256_and_si256(prev1, nib))),
+                _mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+            __m256i must23 = _mm256_or_si256(
+                _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+                _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+            __m256i must23_80 = _mm256_and_si256(must23, _mm256_set1_epi8(static_cast<char>(0x80)));
+            err = _mm256_or_si256(err, _mm256_xor_si256(must23_80, sc));
+            prevIncomplete = _mm256_subs_epu8(in, incompleteMax);
+        }
+        prevInput = in;
+    }
+    err = _mm256_or_si256(err, prevIncomplete);
+    sawCR |= _mm256_movemask_epi8(crAcc) != 0;
+    return _mm256_testz_si256(err, err) != 0;
+}
+#endif
+} // namespace detail
+
+// True if `s` is well-formed UTF-8; `sawCR` is set if any '\r' byte occurs.
+inline bool utf8Validate(std::string_view s, bool& sawCR, SimdLevel lvl = simdLevel()){
+    auto p = reinterpret_cast<const unsigned char*>(s.data());
+#if SCRIPTED_SIMD_X86
+    if (lvl == SimdLevel::AVX2) return detail::utf8ValidateAVX2(p, s.size(), sawCR);
+    if (lvl == SimdLevel::SSE2) return detail::utf8ValidateSSE2(p, s.size(), sawCR);
+#endif
+    (void)lvl;
+    return detail::utf8ValidateScalar(p, s.size(), sawCR);
+}
+
+struct TextCheck {
+    size_t invalid = 0;       // ill-formed UTF-8 sequences
+    size_t firstInvalid = 0;  // byte offset of the first one (file offset, BOM included)
+    size_t firstLine = 0;     // 1-based line of the first one
+    size_t lineBreaks = 0;    // CRLF / lone CR converted to LF
+    bool   bom = false;
+};
+
+// Strip BOM, validate UTF-8 and normalise CRLF/CR to LF in place. Strict fails
+// on the first ill-formed sequence; Repair replaces each with U+FFFD.
+inline bool normalizeBankText(string& text, Utf8Policy policy, TextCheck& chk, string& err,
+                              SimdLevel lvl = simdLevel()){
+    chk = {};
+    if (text.size() >= 3 &&
+        static_cast<unsigned char>(text[0]) == 0xEF &&
+        static_cast<unsigned char>(text[1]) == 0xBB &&
+        static_cast<unsigned char>(text[2]) == 0xBF) {
+        text.erase(0, 3);
+        chk.bom = true;
+    }
+    bool sawCR = false;
+    if (!utf8Validate(text, sawCR, lvl)){
+        auto p = reinterpret_cast<const unsigned char*>(text.data());
+        auto end = p + text.size();
+        string fixed; fixed.reserve(text.size() + 16);
+        size_t line = 1;
+        for (auto q = p; q < end; ){
+            size_t bad = 0, len = detail::utf8SeqLen(q, end, bad);
+            if (len) {
+                if (*q == '\n') ++line;
+                fixed.append(reinterpret_cast<const char*>(q), len);
+                q += len;
+                continue;
+            }
+            if (chk.invalid++ == 0) {
+                chk.firstInvalid = size_t(q - p) + (chk.bom ? 3 : 0);
+                chk.firstLine = line;
+                if (policy == Utf8Policy::Strict) break;
+            }
+            fixed += "\xEF\xBF\xBD";
+            q += bad;
+        }
+        if (policy == Utf8Policy::Strict) {
+            err = "invalid UTF-8 at byte " + std::to_string(chk.firstInvalid) +
+                  " (line " + std::to_string(chk.firstLine) + ")";
+            return false;
+        }
+        text.swap(fixed);
+    }
+    if (sawCR){
+        size_t w = 0;
+        for (size_t r = 0; r < text.size(); ){
+            const void* hit = std::memchr(text.data() + r, '\r', text.size() - r);
+            size_t cr = hit ? size_t(static_cast<const char*>(hit) - text.data()) : text.size();
+            if (w != r) std::memmove(&text[w], text.data() + r, cr - r);
+            w += cr - r;
+            if (cr == text.size()) break;
+            text[w++] = '\n';
+            ++chk.lineBreaks;
+            r = cr + 1;
+            if (r < text.size() && text[r] == '\n') ++r;
+        }
+        text.resize(w);
+    }
+    return true;
+}
+
 // ----------------------------- Config/Paths/Model -----------------------------
 struct Config {
     char prefix = 'x';
@@ -101,15 +455,29 @@ struct Config {
     int  widthBank = 5;
     int  widthReg  = 2;
     int  widthAddr = 4;
+    Utf8Policy utf8 = Utf8Policy::Repair; // ill-formed bank text: fail (strict) or U+FFFD (repair)
+    int  cliCores = 1;                    // CPUs kept for the CLI during parallel plugin runs
+    bool artifactStore = false;           // plugin artifacts: per-run directories (false) or segment store
+    int  artifactKeep = 3;                // store retention: newest runs kept per cell+plugin (0: all)
+    int  coldAfter = 300;                 // seconds idle before a loaded bank is compressed in RAM (0: never)
+    bool inferTypes = true;               // type undeclared all-numeric / fixed-hex registers at load
+    int  deadlineMs = 0;                  // per-command time limit in ms (0: none)
 
     string toJSON() const {
         std::ostringstream os;
         os << "{\n";
-        os << "  \"prefix\": \"" << prefix << "\",\n";
+        os << "  \"prefix\": \"" << jsonEscape(string(1, prefix)) << "\",\n";
         os << "  \"base\": " << base << ",\n";
         os << "  \"widthBank\": " << widthBank << ",\n";
         os << "  \"widthReg\": " << widthReg << ",\n";
-        os << "  \"widthAddr\": " << widthAddr << "\n";
+        os << "  \"widthAddr\": " << widthAddr << ",\n";
+        os << "  \"utf8\": \"" << (utf8 == Utf8Policy::Strict ? "strict" : "repair") << "\",\n";
+        os << "  \"cliCores\": " << cliCores << ",\n";
+        os << "  \"artifacts\": \"" << (artifactStore ? "store" : "tree") << "\",\n";
+        os << "  \"artifactKeep\": " << artifactKeep << ",\n";
+        os << "  \"coldAfter\": " << coldAfter << ",\n";
+        os << "  \"types\": \"" << (inferTypes ? "infer" : "declared") << "\",\n";
+        os << "  \"deadlineMs\": " << deadlineMs << "\n";
         os << "}\n";
         return os.str();
     }
@@ -138,6 +506,13 @@ struct Config {
         c.widthBank  = getInt("widthBank", 5);
         c.widthReg   = getInt("widthReg", 2);
         c.widthAddr  = getInt("widthAddr", 4);
+        c.utf8       = getStr("utf8", "repair") == "strict" ? Utf8Policy::Strict : Utf8Policy::Repair;
+        c.cliCores   = getInt("cliCores", 1);
+        c.artifactStore = getStr("artifacts", "tree") == "store";
+        c.artifactKeep  = getInt("artifactKeep", 3);
+        c.coldAfter     = getInt("coldAfter", 300);
+        c.inferTypes    = getStr("types", "infer") != "declared";
+        c.deadlineMs    = getInt("deadlineMs", 0);
         return c;
     }
 };
@@ -152,53 +527,802 @@ struct Paths {
     }
 };
 
+// ----------------------------- Typed registers -----------------------------
+// A register whose values are all canonical int64, float64 or fixed-width hex
+// is stored as a Column: sorted addresses (implicit when contiguous) plus one
+// packed native array. Values are formatted back to text on access, byte for
+// byte as they were read; anything that would not round-trip stays text.
+// Declared registers (a type after the register id in the file) are `loose`:
+// any value of the type is accepted and written back in canonical form.
+enum class ColType : uint8_t { Text, Int64, Float64, Bytes };
+
+struct ColSpec {
+    ColType  type = ColType::Text;
+    uint16_t width = 0;      // Bytes: bytes per value
+    bool     upper = false;  // Bytes: A-F rather than a-f
+    bool     prefixed = false; // Bytes: leading "0x"
+    bool     loose = false;  // declared: normalise instead of requiring exact round trip
+    bool operator==(const ColSpec&) const = default;
+};
+
+inline string colTypeName(const ColSpec& s) {
+    switch (s.type) {
+        case ColType::Int64:   return "int64";
+        case ColType::Float64: return "float64";
+        case ColType::Bytes:   return "bytes" + std::to_string(s.width);
+        default:               return "text";
+    }
+}
+
+// Declarations as written after a register id: text | int64 | float64 | bytes<N>
+// (hex case and "0x" of a declared bytes register follow its first value).
+inline bool parseColType(std::string_view t, ColSpec& s) {
+    s = {};
+    if (t == "text") return true;
+    if (t == "int64")   { s.type = ColType::Int64;   return true; }
+    if (t == "float64") { s.type = ColType::Float64; return true; }
+    unsigned w = 0;
+    if (t.size() > 5 && t.substr(0, 5) == "bytes") {
+        auto r = std::from_chars(t.data() + 5, t.data() + t.size(), w);
+        if (r.ec == std::errc{} && r.ptr == t.data() + t.size() && w >= 1 && w <= 1024) {
+            s.type = ColType::Bytes; s.width = static_cast<uint16_t>(w); return true;
+        }
+    }
+    return false;
+}
+
+namespace detail {
+inline bool canonInt(std::string_view v, int64_t& x) {
+    if (v.empty() || v.size() > 20) return false;
+    auto r = std::from_chars(v.data(), v.data() + v.size(), x);
+    if (r.ec != std::errc{} || r.ptr != v.data() + v.size()) return false;
+    char buf[24];
+    auto w = std::to_chars(buf, buf + sizeof(buf), x);
+    return std::string_view(buf, static_cast<size_t>(w.ptr - buf)) == v;
+}
+inline bool canonFloat(std::string_view v, double& x) {
+    if (v.empty() || v.size() > 32) return false;
+    auto r = std::from_chars(v.data(), v.data() + v.size(), x);
+    if (r.ec != std::errc{} || r.ptr != v.data() + v.size()) return false;
+    char buf[40];
+    auto w = std::to_chars(buf, buf + sizeof(buf), x);
+    return std::string_view(buf, static_cast<size_t>(w.ptr - buf)) == v;
+}
+inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+// Hex case of v: 0 digits only, 1 lower, 2 upper, 3 mixed or not hex.
+inline int hexCase(std::string_view v) {
+    int c = 0;
+    for (char ch : v) {
+        if (ch >= '0' && ch <= '9') continue;
+        if (ch >= 'a' && ch <= 'f') c |= 1;
+        else if (ch >= 'A' && ch <= 'F') c |= 2;
+        else return 3;
+    }
+    return c;
+}
+} // namespace detail
+
+// True if v can be stored as `s` (and, unless loose, formats back to exactly v).
+inline bool colFits(const ColSpec& s, std::string_view v) {
+    int64_t i; double d;
+    auto whole = [&](auto& x) {
+        if (v.starts_with('+')) v.remove_prefix(1);
+        auto r = std::from_chars(v.data(), v.data() + v.size(), x);
+        return !v.empty() && r.ec == std::errc{} && r.ptr == v.data() + v.size();
+    };
+    switch (s.type) {
+        case ColType::Int64:   return s.loose ? whole(i) : detail::canonInt(v, i);
+        case ColType::Float64: return s.loose ? whole(d) : detail::canonFloat(v, d);
+        case ColType::Bytes: {
+            if (s.prefixed || s.loose) {
+                if (v.starts_with("0x")) v.remove_prefix(2);
+                else if (!s.loose) return false;
+            }
+            if (v.size() != size_t(s.width) * 2) return false;
+            int c = detail::hexCase(v);
+            return c == 0 || c == (s.upper ? 2 : 1) || (s.loose && c != 3);
+        }
+        default: return true;
+    }
+}
+
+// Narrowest spec that holds every value in `m` (Text when none does).
+inline ColSpec inferColSpec(const std::map<long long, string>& m) {
+    ColSpec s;
+    if (m.empty()) return s;
+    bool isInt = true, isFloat = true, isBytes = true;
+    const string& v0 = m.begin()->second;
+    bool prefixed = v0.size() > 2 && v0[0] == '0' && v0[1] == 'x';
+    size_t len = v0.size();
+    int cases = 0;
+    int64_t i; double d;
+    for (auto& [a, v] : m) {
+        if (isInt && !detail::canonInt(v, i)) isInt = false;
+        if (!isInt && isFloat && !detail::canonFloat(v, d)) isFloat = false;
+        if (isBytes) {
+            std::string_view h(v);
+            if (v.size() != len || (prefixed && h.substr(0, 2) != "0x")) isBytes = false;
+            else {
+                if (prefixed) h.remove_prefix(2);
+                int c = detail::hexCase(h);
+                cases |= c;
+                if (c == 3 || cases == 3 || h.size() % 2 || h.empty() || h.size() > 2048) isBytes = false;
+            }
+        }
+        if (!isInt && !isFloat && !isBytes) return s;
+    }
+    if (isInt) s.type = ColType::Int64;
+    else if (isFloat) s.type = ColType::Float64;
+    else {
+        s.type = ColType::Bytes;
+        s.prefixed = prefixed;
+        s.upper = cases == 2;
+        s.width = static_cast<uint16_t>((len - (prefixed ? 2 : 0)) / 2);
+    }
+    return s;
+}
+
+// Storage spec for a declared type; bytes take their hex case and "0x" from `sample`.
+inline ColSpec declaredSpec(ColSpec s, std::string_view sample) {
+    s.loose = true;
+    if (s.type == ColType::Bytes) {
+        s.prefixed = sample.starts_with("0x");
+        s.upper = detail::hexCase(sample.substr(s.prefixed ? 2 : 0)) == 2;
+    }
+    return s;
+}
+
+struct Column {
+    ColSpec spec;
+    long long first = 0;           // dense: cell i lives at first + i
+    std::vector<long long> addrs;  // sparse: sorted addresses (empty while dense)
+    std::vector<int64_t> i64;
+    std::vector<double>  f64;
+    std::vector<uint8_t> bytes;    // spec.width bytes per cell
+    size_t n = 0;
+
+    size_t size() const { return n; }
+    bool dense() const { return addrs.empty(); }
+    long long addrAt(size_t k) const { return dense() ? first + static_cast<long long>(k) : addrs[k]; }
+    size_t lowerBound(long long a) const {
+        if (dense()) return a <= first ? 0 : static_cast<size_t>(std::min<uint64_t>(n, uint64_t(a) - uint64_t(first)));
+        return static_cast<size_t>(std::lower_bound(addrs.begin(), addrs.end(), a) - addrs.begin());
+    }
+    size_t upperBound(long long a) const {
+        if (dense()) return a < first ? 0 : static_cast<size_t>(std::min<uint64_t>(n, uint64_t(a) - uint64_t(first) + 1));
+        return static_cast<size_t>(std::upper_bound(addrs.begin(), addrs.end(), a) - addrs.begin());
+    }
+    bool find(long long a, size_t& k) const {
+        k = lowerBound(a);
+        return k < n && addrAt(k) == a;
+    }
+
+    void formatTo(size_t k, string& out) const {
+        char buf[40];
+        switch (spec.type) {
+            case ColType::Int64: {
+                auto r = std::to_chars(buf, buf + sizeof(buf), i64[k]);
+                out.assign(buf, r.ptr);
+                break;
+            }
+            case ColType::Float64: {
+                auto r = std::to_chars(buf, buf + sizeof(buf), f64[k]);
+                out.assign(buf, r.ptr);
+                break;
+            }
+            case ColType::Bytes: {
+                const char* digits = spec.upper ? "0123456789ABCDEF" : "0123456789abcdef";
+                out.assign(spec.prefixed ? "0x" : "");
+                const uint8_t* p = bytes.data() + k * spec.width;
+                for (size_t j = 0; j < spec.width; ++j) { out += digits[p[j] >> 4]; out += digits[p[j] & 15]; }
+                break;
+            }
+            default: out.clear();
+        }
+    }
+    string format(size_t k) const { string s; formatTo(k, s); return s; }
+
+    // Appends (a must exceed every stored address); false if v does not fit.
+    bool push(long long a, std::string_view v) {
+        if (!colFits(spec, v)) return false;
+        if (n == 0) first = a;
+        else if (dense() && a != first + static_cast<long long>(n)) sparsify();
+        if (!dense()) addrs.push_back(a);
+        ++n;
+        store(n - 1, v, true);
+        return true;
+    }
+    // Inserts or replaces; false (and unchanged) if v does not fit.
+    bool set(long long a, std::string_view v) {
+        if (!colFits(spec, v)) return false;
+        size_t k;
+        if (find(a, k)) { store(k, v, false); return true; }
+        if (k == n) return push(a, v);
+        sparsify();
+        addrs.insert(addrs.begin() + static_cast<std::ptrdiff_t>(k), a);
+        switch (spec.type) {
+            case ColType::Int64:   i64.insert(i64.begin() + static_cast<std::ptrdiff_t>(k), 0); break;
+            case ColType::Float64: f64.insert(f64.begin() + static_cast<std::ptrdiff_t>(k), 0); break;
+            case ColType::Bytes:   bytes.insert(bytes.begin() + static_cast<std::ptrdiff_t>(k * spec.width), spec.width, 0); break;
+            default: break;
+        }
+        ++n;
+        store(k, v, false);
+        return true;
+    }
+    bool erase(long long a) {
+        size_t k;
+        if (!find(a, k)) return false;
+        if (!dense() || (k != 0 && k + 1 != n)) {
+            sparsify();
+            addrs.erase(addrs.begin() + static_cast<std::ptrdiff_t>(k));
+        } else if (k == 0) ++first;
+        switch (spec.type) {
+            case ColType::Int64:   i64.erase(i64.begin() + static_cast<std::ptrdiff_t>(k)); break;
+            case ColType::Float64: f64.erase(f64.begin() + static_cast<std::ptrdiff_t>(k)); break;
+            case ColType::Bytes: {
+                auto b = bytes.begin() + static_cast<std::ptrdiff_t>(k * spec.width);
+                bytes.erase(b, b + spec.width);
+                break;
+            }
+            default: break;
+        }
+        --n;
+        return true;
+    }
+    uint64_t heapBytes() const {
+        auto cap = [](const auto& v) -> uint64_t { return v.capacity() ? v.capacity() * sizeof(v[0]) : 0; };
+        return cap(addrs) + cap(i64) + cap(f64) + cap(bytes);
+    }
+    void shrink() { addrs.shrink_to_fit(); i64.shrink_to_fit(); f64.shrink_to_fit(); bytes.shrink_to_fit(); }
+
+private:
+    void sparsify() {
+        if (!dense() || n == 0) return;
+        addrs.resize(n);
+        for (size_t k = 0; k < n; ++k) addrs[k] = first + static_cast<long long>(k);
+    }
+    void store(size_t k, std::string_view v, bool append) {
+        if (spec.loose && v.starts_with('+')) v.remove_prefix(1);
+        switch (spec.type) {
+            case ColType::Int64: {
+                int64_t x = 0; std::from_chars(v.data(), v.data() + v.size(), x);
+                if (append) i64.push_back(x); else i64[k] = x;
+                break;
+            }
+            case ColType::Float64: {
+                double x = 0; std::from_chars(v.data(), v.data() + v.size(), x);
+                if (append) f64.push_back(x); else f64[k] = x;
+                break;
+            }
+            case ColType::Bytes: {
+                if (v.starts_with("0x")) v.remove_prefix(2);
+                if (append) bytes.resize(bytes.size() + spec.width);
+                uint8_t* p = bytes.data() + k * spec.width;
+                for (size_t j = 0; j < spec.width; ++j)
+                    p[j] = static_cast<uint8_t>(detail::hexNibble(v[2 * j]) << 4 | detail::hexNibble(v[2 * j + 1]));
+                break;
+            }
+            default: break;
+        }
+    }
+};
+
 struct Bank {
     long long id = 0;
     string title;
-    // reg -> (addr -> value)
+    // reg -> (addr -> value); text registers only
     std::map<long long, std::map<long long, string>> regs;
+    // typed registers (never also in regs), and the types declared in the file
+    std::map<long long, Column> cols;
+    std::map<long long, ColSpec> decl;
+
     bool empty() const {
-        if (regs.empty()) return true;
         for (auto& [r, addrs] : regs) if (!addrs.empty()) return false;
+        for (auto& [r, c] : cols) if (c.size()) return false;
+        return true;
+    }
+    bool hasReg(long long reg) const { return regs.count(reg) || cols.count(reg); }
+    size_t regCount() const { return regs.size() + cols.size(); }
+    size_t cellCount() const {
+        size_t n = 0;
+        for (auto& [r, addrs] : regs) n += addrs.size();
+        for (auto& [r, c] : cols) n += c.size();
+        return n;
+    }
+
+    bool get(long long reg, long long addr, string& out) const {
+        if (auto itR = regs.find(reg); itR != regs.end()) {
+            auto itA = itR->second.find(addr);
+            if (itA == itR->second.end()) return false;
+            out = itA->second;
+            return true;
+        }
+        auto itC = cols.find(reg);
+        size_t k;
+        if (itC == cols.end() || !itC->second.find(addr, k)) return false;
+        itC->second.formatTo(k, out);
+        return true;
+    }
+
+    // Writes a cell. A value that does not fit an inferred column turns the
+    // register back into text; one that does not fit a declared type is refused.
+    bool set(long long reg, long long addr, string value, string& err) {
+        if (auto itC = cols.find(reg); itC != cols.end()) {
+            if (itC->second.set(addr, value)) return true;
+            if (decl.count(reg)) {
+                err = "register " + std::to_string(reg) + " is declared " + colTypeName(itC->second.spec);
+                return false;
+            }
+            untype(reg);
+        } else if (auto itD = decl.find(reg); itD != decl.end() && itD->second.type != ColType::Text && !regs.count(reg)) {
+            Column c; c.spec = declaredSpec(itD->second, value);
+            if (!c.push(addr, value)) { err = "register " + std::to_string(reg) + " is declared " + colTypeName(c.spec); return false; }
+            cols[reg] = std::move(c);
+            return true;
+        }
+        regs[reg][addr] = std::move(value);
+        return true;
+    }
+
+    // 0: no such register, 1: no such address, 2: erased (an emptied register is dropped).
+    int erase(long long reg, long long addr) {
+        if (auto itR = regs.find(reg); itR != regs.end()) {
+            if (!itR->second.erase(addr)) return 1;
+            if (itR->second.empty()) regs.erase(itR);
+            return 2;
+        }
+        auto itC = cols.find(reg);
+        if (itC == cols.end()) return 0;
+        if (!itC->second.erase(addr)) return 1;
+        if (!itC->second.size()) cols.erase(itC);
+        return 2;
+    }
+
+    // Stored addresses of `reg` within [from, to].
+    std::vector<long long> addrsInRange(long long reg, long long from, long long to) const {
+        std::vector<long long> out;
+        if (auto itR = regs.find(reg); itR != regs.end()) {
+            for (auto it = itR->second.lower_bound(from); it != itR->second.end() && it->first <= to; ++it)
+                out.push_back(it->first);
+        } else if (auto itC = cols.find(reg); itC != cols.end()) {
+            const Column& c = itC->second;
+            for (size_t k = c.lowerBound(from); k < c.size() && c.addrAt(k) <= to; ++k) out.push_back(c.addrAt(k));
+        }
+        return out;
+    }
+
+    // f(reg, addr) / f(reg, addr, const string& value) over every cell in key order.
+    template <class F> void forEachKey(F&& f) const {
+        walk([&](long long r, const std::map<long long, string>* m, const Column* c) {
+            if (m) for (auto& [a, v] : *m) f(r, a);
+            else for (size_t k = 0; k < c->size(); ++k) f(r, c->addrAt(k));
+        });
+    }
+    template <class F> void forEachCell(F&& f) const {
+        string tmp;
+        walk([&](long long r, const std::map<long long, string>* m, const Column* c) {
+            if (m) for (auto& [a, v] : *m) f(r, a, v);
+            else for (size_t k = 0; k < c->size(); ++k) { c->formatTo(k, tmp); f(r, c->addrAt(k), tmp); }
+        });
+    }
+
+    // Moves a typed register back to text storage.
+    void untype(long long reg) {
+        auto itC = cols.find(reg);
+        if (itC == cols.end()) return;
+        auto& m = regs[reg];
+        for (size_t k = 0; k < itC->second.size(); ++k) m.emplace_hint(m.end(), itC->second.addrAt(k), itC->second.format(k));
+        cols.erase(itC);
+    }
+
+private:
+    template <class F> void walk(F&& f) const {
+        auto itR = regs.begin(); auto itC = cols.begin();
+        while (itR != regs.end() || itC != cols.end()) {
+            if (itC == cols.end() || (itR != regs.end() && itR->first < itC->first)) { f(itR->first, &itR->second, nullptr); ++itR; }
+            else { f(itC->first, nullptr, &itC->second); ++itC; }
+        }
+    }
+};
+
+// Moves text registers into columns: declared ones must fit their type, others
+// are converted when inference finds a type every value round-trips through.
+inline bool applyRegisterTypes(Bank& b, bool infer, string& err) {
+    std::vector<long long> ids;
+    for (auto& [r, m] : b.regs) ids.push_back(r);
+    for (long long r : ids) {
+        auto& m = b.regs[r];
+        ColSpec spec;
+        auto itD = b.decl.find(r);
+        if (itD != b.decl.end()) { if (!m.empty()) spec = declaredSpec(itD->second, m.begin()->second); }
+        else if (infer) spec = inferColSpec(m);
+        if (spec.type == ColType::Text || m.empty()) continue;
+        Column c; c.spec = spec;
+        for (auto& [a, v] : m)
+            if (!c.push(a, v)) {
+                err = "register " + std::to_string(r) + " is declared " + colTypeName(spec) +
+                      " but address " + std::to_string(a) + " holds \"" + v.substr(0, 40) + "\"";
+                return false;
+            }
+        c.shrink();
+        b.cols[r] = std::move(c);
+        b.regs.erase(r);
+    }
+    return true;
+}
+
+// Re-derives the storage of one register from its current declaration; on
+// failure (values do not fit the declared type) the register is left as text.
+inline bool retypeRegister(Bank& b, long long reg, bool infer, string& err) {
+    b.untype(reg);
+    auto it = b.regs.find(reg);
+    if (it == b.regs.end()) return true;
+    Bank part;
+    if (auto itD = b.decl.find(reg); itD != b.decl.end()) part.decl[reg] = itD->second;
+    part.regs[reg] = std::move(it->second);
+    b.regs.erase(it);
+    bool ok = applyRegisterTypes(part, infer, err);
+    for (auto& [r, m] : part.regs) b.regs[r] = std::move(m);
+    for (auto& [r, c] : part.cols) b.cols[r] = std::move(c);
+    return ok;
+}
+
+// Bloom filter over a bank's (reg, addr) keys, persisted next to the bank file
+// (files/<ctx>.bloom) so lookups into a bank that is not loaded can be rejected
+// without parsing it. srcSize/srcMtime pin the .txt it was built from, layout
+// the settings its keys were parsed with (prefix, base, widths).
+struct BankBloom {
+    uint64_t srcSize = 0;
+    int64_t  srcMtime = 0;
+    uint64_t layout = 0;
+    uint32_t k = 7;
+    std::vector<uint64_t> bits;
+
+    static uint64_t mix(uint64_t x){
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+    static uint64_t hashKey(long long reg, long long addr){
+        return mix(mix(static_cast<uint64_t>(reg)) ^ static_cast<uint64_t>(addr));
+    }
+    static uint64_t layoutOf(const Config& cfg){
+        uint64_t h = mix(static_cast<unsigned char>(cfg.prefix));
+        for (int v : {cfg.base, cfg.widthBank, cfg.widthReg, cfg.widthAddr}) h = mix(h ^ static_cast<uint32_t>(v));
+        return h;
+    }
+    void build(const Bank& b){
+        size_t n = b.cellCount();
+        bits.assign(std::max<size_t>(1, (n * 10 + 63) / 64), 0); // ~10 bits/key, ~1% false positives
+        b.forEachKey([&](long long r, long long a) {
+            uint64_t h = hashKey(r, a), h2 = (h >> 32) | 1, m = bits.size() * 64;
+            for (uint32_t i = 0; i < k; ++i, h += h2) bits[(h % m) >> 6] |= 1ULL << ((h % m) & 63);
+        });
+    }
+    bool mayContain(long long reg, long long addr) const {
+        if (bits.empty()) return true;
+        uint64_t h = hashKey(reg, addr), h2 = (h >> 32) | 1, m = bits.size() * 64;
+        for (uint32_t i = 0; i < k; ++i, h += h2)
+            if (!(bits[(h % m) >> 6] & (1ULL << ((h % m) & 63)))) return false;
+        return true;
+    }
+    string serialize() const {
+        string s("SBF2", 4);
+        auto put = [&](const void* p, size_t n){ s.append(static_cast<const char*>(p), n); };
+        uint64_t words = bits.size();
+        put(&srcSize, 8); put(&srcMtime, 8); put(&layout, 8); put(&k, 4); put(&words, 8);
+        put(bits.data(), words * 8);
+        return s;
+    }
+    bool parse(const string& s){
+        if (s.size() < 40 || s.compare(0, 4, "SBF2") != 0) return false;
+        uint64_t words = 0;
+        std::memcpy(&srcSize, s.data() + 4, 8);
+        std::memcpy(&srcMtime, s.data() + 12, 8);
+        std::memcpy(&layout, s.data() + 20, 8);
+        std::memcpy(&k, s.data() + 28, 4);
+        std::memcpy(&words, s.data() + 32, 8);
+        if (k == 0 || k > 32 || words > (s.size() - 40) / 8 || s.size() != 40 + words * 8) return false;
+        bits.resize(words);
+        std::memcpy(bits.data(), s.data() + 40, words * 8);
         return true;
     }
 };
 
+// ---------- LZ block codec (cold tier) ----------
+// Byte-oriented LZ77 in the LZ4 block layout: token (literal length << 4 |
+// match length - 4), extended lengths as 255-runs, literals, 16-bit offset.
+// The last sequence is literals only. No entropy stage: it is meant to be
+// cheap to decode, not small.
+namespace lz {
+inline void putLen(string& o, size_t n) {
+    for (; n >= 255; n -= 255) o.push_back(static_cast<char>(255));
+    o.push_back(static_cast<char>(n));
+}
+
+inline string compress(std::string_view in) {
+    const size_t n = in.size();
+    const char* src = in.data();
+    string out;
+    out.reserve(n / 2 + 16);
+    std::vector<uint32_t> table(1u << 14, 0);  // hash of 4 bytes -> position + 1
+    size_t anchor = 0, i = 0;
+    while (n >= 8 && i + 4 <= n) {
+        uint32_t v; std::memcpy(&v, src + i, 4);
+        uint32_t h = (v * 2654435761u) >> 18;
+        size_t cand = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+        if (!cand || i - (cand - 1) > 65535 || std::memcmp(src + cand - 1, src + i, 4) != 0) { ++i; continue; }
+        size_t c = cand - 1, len = 4;
+        while (i + len < n && src[c + len] == src[i + len]) ++len;
+        size_t lit = i - anchor, ml = len - 4;
+        out.push_back(static_cast<char>((std::min<size_t>(lit, 15) << 4) | std::min<size_t>(ml, 15)));
+        if (lit >= 15) putLen(out, lit - 15);
+        out.append(src + anchor, lit);
+        size_t off = i - c;
+        out.push_back(static_cast<char>(off & 255));
+        out.push_back(static_cast<char>(off >> 8));
+        if (ml >= 15) putLen(out, ml - 15);
+        i += len;
+        anchor = i;
+    }
+    size_t lit = n - anchor;
+    out.push_back(static_cast<char>(std::min<size_t>(lit, 15) << 4));
+    if (lit >= 15) putLen(out, lit - 15);
+    out.append(src + anchor, lit);
+    return out;
+}
+
+inline bool decompress(std::string_view in, size_t rawSize, string& out) {
+    out.resize(rawSize);
+    size_t ip = 0, op = 0;
+    auto getLen = [&](size_t& n) {
+        for (uint8_t b = 255; b == 255; n += b) {
+            if (ip >= in.size()) return false;
+            b = static_cast<uint8_t>(in[ip++]);
+        }
+        return true;
+    };
+    while (ip < in.size()) {
+        uint8_t tok = static_cast<uint8_t>(in[ip++]);
+        size_t lit = tok >> 4;
+        if (lit == 15 && !getLen(lit)) return false;
+        if (ip + lit > in.size() || op + lit > rawSize) return false;
+        std::memcpy(out.data() + op, in.data() + ip, lit);
+        ip += lit; op += lit;
+        if (ip == in.size()) break;             // final literal run
+        if (ip + 2 > in.size()) return false;
+        size_t off = static_cast<uint8_t>(in[ip]) | (static_cast<size_t>(static_cast<uint8_t>(in[ip + 1])) << 8);
+        ip += 2;
+        size_t ml = tok & 15;
+        if (ml == 15 && !getLen(ml)) return false;
+        ml += 4;
+        if (off == 0 || off > op || op + ml > rawSize) return false;
+        char* d = out.data() + op;
+        const char* m = d - off;
+        if (off >= ml) std::memcpy(d, m, ml);
+        else for (size_t k = 0; k < ml; ++k) d[k] = m[k];  // overlapping run
+        op += ml;
+    }
+    return op == rawSize;
+}
+} // namespace lz
+
+// A bank parked in RAM in compressed form: its maps are freed, a Bloom filter
+// answers misses without thawing, and the next real access decompresses it.
+struct ColdBank {
+    string    blob;          // lz::compress(serialized bank)
+    uint64_t  rawSize = 0;   // serialized size
+    uint64_t  textBytes = 0; // cell text inside it
+    size_t    cells = 0;
+    BankBloom bloom;
+};
+
+// ----------------------------- Single-flight -----------------------------
+// Coalesces concurrent calls with the same key: the first caller runs fn, later
+// callers block until it finishes and get a copy of its result (or exception).
+// Nothing is cached; a call after the flight lands runs fn again.
+template <class Key, class Result, class Hash = std::hash<Key>>
+class SingleFlight {
+public:
+    struct Stats {
+        uint64_t executed = 0;    // calls that ran fn
+        uint64_t coalesced = 0;   // calls that waited on another's fn
+        size_t   inFlight = 0;
+        size_t   peakWaiters = 0; // most callers ever parked on one flight
+    };
+
+    template <class Fn>
+    Result run(const Key& key, Fn&& fn, bool* shared = nullptr) {
+        std::unique_lock lk(mu_);
+        if (auto it = calls_.find(key); it != calls_.end()) {
+            std::shared_ptr<Call> c = it->second;
+            ++stats_.coalesced;
+            stats_.peakWaiters = std::max(stats_.peakWaiters, ++c->waiters);
+            done_.wait(lk, [&] { return c->done; });
+            if (shared) *shared = true;
+            if (c->error) std::rethrow_exception(c->error);
+            return c->result;
+        }
+        auto c = std::make_shared<Call>();
+        calls_.emplace(key, c);
+        ++stats_.executed;
+        lk.unlock();
+        try {
+            Result r = fn();
+            lk.lock();
+            c->result = std::move(r);
+        } catch (...) {
+            if (!lk.owns_lock()) lk.lock();
+            c->error = std::current_exception();
+        }
+        c->done = true;
+        calls_.erase(key);
+        lk.unlock();
+        done_.notify_all();
+        if (shared) *shared = false;
+        if (c->error) std::rethrow_exception(c->error);
+        return c->result;
+    }
+
+    Stats stats() const {
+        std::lock_guard lk(mu_);
+        Stats s = stats_;
+        s.inFlight = calls_.size();
+        return s;
+    }
+
+private:
+    struct Call {
+        bool               done = false;
+        size_t             waiters = 0;
+        Result             result{};
+        std::exception_ptr error;
+    };
+    mutable std::mutex mu_;
+    std::condition_variable done_;
+    std::unordered_map<Key, std::shared_ptr<Call>, Hash> calls_;
+    Stats stats_;
+};
+
+// `mu` guards the maps below against concurrent bank loads (several threads
+// resolving through one Workspace); `loads` makes those threads share a single
+// parse per bank. Edits to a bank's cells still belong to one thread.
 struct Workspace {
+    std::mutex mu;
+    SingleFlight<long long, std::pair<bool, string>> loads; // id -> (ok, error)
     std::map<long long, Bank> banks;       // id -> Bank
     std::map<long long, string> filenames; // id -> path
+    std::map<long long, string> warnings;  // id -> load diagnostics (e.g. repaired UTF-8)
+    std::map<long long, std::optional<BankBloom>> blooms; // id -> sidecar of an unloaded bank (nullopt: none/stale)
+    std::map<long long, ColdBank> cold;    // id -> compressed bank (not in `banks`)
+    std::map<long long, std::chrono::steady_clock::time_point> touched; // id -> last access
+    // Set in a farm worker (scripted_farm.hpp): fetches a cell of a bank another
+    // process owns. Returns 1 found, 0 missing, -1 not remote (look it up here).
+    std::function<int(long long bank, long long reg, long long addr, string& out)> remoteCell;
+    // Banks and @file names resolvers read, recorded into every registered sink
+    // (:foreach fingerprints each bank by what its command read). Guarded by mu.
+    struct Reads { std::set<long long> banks; std::set<string> files; };
+    std::vector<Reads*> readSinks;
+};
+
+// ----------------------------- Cancellation -----------------------------
+// Long operations poll a CancelToken between banks and cells and stop early,
+// leaving whatever they already finished in place. A token is cancelled by
+// SIGINT (see SigintScope) or runs out at its deadline.
+struct CancelToken {
+    using clock = std::chrono::steady_clock;
+    std::atomic<bool> requested{false};
+    clock::time_point deadline = clock::time_point::max();
+    int deadlineMs = 0;
+    // Background work (scripted_pool.hpp) pauses here while interactive work runs;
+    // every cancellation check doubles as a yield point.
+    std::function<void()> yield;
+
+    // Re-arms for a new command; 0 means no deadline.
+    void arm(int ms) {
+        requested.store(false);
+        deadlineMs = ms;
+        deadline = ms > 0 ? clock::now() + std::chrono::milliseconds(ms) : clock::time_point::max();
+    }
+    void cancel() noexcept { requested.store(true, std::memory_order_relaxed); }
+    bool expired() const {
+        if (requested.load(std::memory_order_relaxed)) return true;
+        return deadline != clock::time_point::max() && clock::now() >= deadline;
+    }
+    string reason() const {
+        if (requested.load()) return "interrupted";
+        return "deadline of " + std::to_string(deadlineMs) + " ms exceeded";
+    }
+};
+inline bool cancelled(const CancelToken* t) {
+    if (!t) return false;
+    if (t->yield) t->yield();
+    return t->expired();
+}
+
+// While alive, Ctrl-C cancels `tok` instead of killing the process; a second
+// Ctrl-C before the command notices falls back to the default action.
+class SigintScope {
+public:
+    explicit SigintScope(CancelToken& tok) {
+        target().store(&tok);
+        prev_ = std::signal(SIGINT, &SigintScope::onSigint);
+    }
+    ~SigintScope() {
+        std::signal(SIGINT, prev_ == SIG_ERR ? SIG_DFL : prev_);
+        target().store(nullptr);
+    }
+    SigintScope(const SigintScope&) = delete;
+    SigintScope& operator=(const SigintScope&) = delete;
+
+private:
+    using Handler = void (*)(int);
+    Handler prev_ = SIG_DFL;
+    static std::atomic<CancelToken*>& target() { static std::atomic<CancelToken*> t{nullptr}; return t; }
+    static void onSigint(int sig) {
+        CancelToken* t = target().load();
+        if (!t || t->requested.exchange(true)) { std::signal(sig, SIG_DFL); std::raise(sig); }
+    }
 };
 
 // ----------------------------- Parsing & I/O -----------------------------
-struct ParseResult { bool ok=true; string err; };
+struct ParseResult {
+    bool ok=true; string err; string warn{};
+    std::vector<std::pair<long long, ColSpec>> types{}; // register type declarations
+    size_t line = 0;                                      // 1-based line of `err` (0: not tied to a line)
+};
 
-inline ParseResult parseBankText(const std::string& text, const Config& cfg, Bank& outBank) {
-    // Strip UTF-8 BOM if present
+inline std::string_view trimView(std::string_view s) {
+    auto sp = [](char c){ return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    while (!s.empty() && sp(s.front())) s.remove_prefix(1);
+    while (!s.empty() && sp(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// Streaming parser: calls onHeader(id, title) once, then onCell(reg, addr, string&& value)
+// per body line in file order, without building a Bank. Lines are views into the
+// normalised text; each value is copied exactly once, into the string handed over.
+// With a `check(reg, addr, value, err) -> bool` the body is scanned once without
+// callbacks first, so a parse or check error reaches the caller before any cell does.
+template <class OnHeader, class OnCell, class Check>
+inline ParseResult parseBankStreamAt(const std::string& text, const Config& cfg, OnHeader&& onHeader, OnCell&& onCell,
+                                     Check&& check, size_t& lineNo) {
+    // Strip BOM, validate UTF-8 per cfg.utf8, normalise CRLF
     std::string content = text;
-    if (content.size() >= 3 &&
-        static_cast<unsigned char>(content[0]) == 0xEF &&
-        static_cast<unsigned char>(content[1]) == 0xBB &&
-        static_cast<unsigned char>(content[2]) == 0xBF) {
-        content.erase(0, 3);
-    }
+    TextCheck chk; string uerr;
+    if (!normalizeBankText(content, cfg.utf8, chk, uerr)) return {false, uerr};
+    string warn;
+    if (chk.invalid)
+        warn = "repaired " + std::to_string(chk.invalid) + " invalid UTF-8 sequence(s), first at byte " +
+               std::to_string(chk.firstInvalid) + " (line " + std::to_string(chk.firstLine) + ")";
 
-    std::vector<std::string> lines;
-    {
-        std::istringstream is(content);
-        std::string line;
-        while (std::getline(is, line)) lines.push_back(line);
-    }
-    if (lines.empty()) return {false, "empty file"};
-    size_t i=0;
-    while (i<lines.size() && trim(lines[i]).empty()) i++;
-    if (i==lines.size()) return {false, "no header found"};
-    string header = trim(lines[i]);
-
-    string headerAccum = header;
-    size_t j=i+1;
-    while (headerAccum.find('{')==string::npos && j<lines.size()){
-        headerAccum += " " + trim(lines[j]);
-        j++;
+    std::string_view rest(content);
+    auto nextLine = [&](std::string_view& line) {
+        if (rest.empty()) return false;
+        size_t nl = rest.find('\n');
+        line = rest.substr(0, nl);
+        rest.remove_prefix(nl == std::string_view::npos ? rest.size() : nl + 1);
+        ++lineNo;
+        return true;
+    };
+    std::string_view line;
+    if (rest.empty()) return {false, "empty file"};
+    bool have = false;
+    while ((have = nextLine(line)) && trimView(line).empty()) {}
+    if (!have) return {false, "no header found"};
+
+    // Header may span lines up to the one holding '{'; the body starts after that line.
+    string headerAccum(trimView(line));
+    while (line.find('{') == std::string_view::npos && nextLine(line)) {
+        headerAccum += ' ';
+        headerAccum += trimView(line);
     }
     if (headerAccum.find('{')==string::npos) return {false, "missing '{' after header"};
 
@@ -212,63 +1336,176 @@ inline ParseResult parseBankText(const std::string& text, const Config& cfg, Ban
     long long bankId;
     if (!parseIntBase(left, cfg.base, bankId)) return {false, "cannot parse bank id"};
 
-    outBank = {};
-    outBank.id = bankId;
-    outBank.title = title;
-
-    size_t bodyStartLine = i;
-    while (bodyStartLine<lines.size() && lines[bodyStartLine].find('{')==string::npos) bodyStartLine++;
-    if (bodyStartLine==lines.size()) return {false, "missing body start"};
-    bodyStartLine++;
-
-    long long currentReg = 1;
-    for (size_t k=bodyStartLine; k<lines.size(); ++k){
-        string s = lines[k];
-        if (s.find('}')!=string::npos) break;
-        if (trim(s).empty()) continue;
-
-        // treat both TAB and SPACE as indentation for address lines
-        if (!s.empty() && s[0] != '\t' && s[0] != ' ') {
-            long long regId;
-            if (!parseIntBase(trim(s), cfg.base, regId)){
-                return {false, "invalid register line: " + trim(s)};
+    const std::string_view body = rest;
+    const size_t bodyLine = lineNo;
+    auto scan = [&](auto&& cell) -> ParseResult {
+        rest = body;
+        lineNo = bodyLine;
+        ParseResult pr{true, {}, warn};
+        long long currentReg = 1;
+        while (nextLine(line)) {
+            if (line.find('}') != std::string_view::npos) break;
+            if (trimView(line).empty()) continue;
+
+            // treat both TAB and SPACE as indentation for address lines
+            // A register line may declare the register's type: "02 int64"
+            if (line[0] != '\t' && line[0] != ' ') {
+                long long regId;
+                std::string_view regLine = trimView(line);
+                size_t sp = regLine.find_first_of(" \t");
+                string regTok(regLine.substr(0, sp));
+                if (!parseIntBase(regTok, cfg.base, regId)){
+                    return {false, "invalid register line: " + string(regLine)};
+                }
+                if (sp != std::string_view::npos) {
+                    ColSpec spec;
+                    std::string_view ty = trimView(regLine.substr(sp));
+                    if (!parseColType(ty, spec)) return {false, "invalid register type: " + string(ty)};
+                    pr.types.emplace_back(regId, spec);
+                }
+                currentReg = regId;
+                continue;
             }
-            currentReg = regId;
-            continue;
+            std::string_view t = line;
+            while (!t.empty() && (t[0]=='\t' || t[0]==' ')) t.remove_prefix(1);
+            size_t sep = t.find('\t');
+            if (sep==std::string_view::npos) sep = t.find(' ');
+            string addrTok(trimView(t.substr(0, sep)));
+            std::string_view val = sep==std::string_view::npos ? std::string_view{} : t.substr(sep+1);
+
+            long long addrId;
+            if (!parseIntBase(addrTok, cfg.base, addrId))
+                return {false, "invalid address id: " + addrTok};
+            string cerr;
+            if (!cell(currentReg, addrId, val, cerr)) return {false, cerr};
         }
-        string t = s;
-        while (!t.empty() && (t[0]=='\t' || t[0]==' ')) t.erase(t.begin());
-        size_t sep = t.find('\t');
-        if (sep==string::npos) sep = t.find(' ');
-        string addrTok, val;
-        if (sep==string::npos){ addrTok = trim(t); val=""; }
-        else { addrTok = trim(t.substr(0, sep)); val = t.substr(sep+1); }
+        return pr;
+    };
 
-        long long addrId;
-        if (!parseIntBase(addrTok, cfg.base, addrId))
-            return {false, "invalid address id: " + addrTok};
-        outBank.regs[currentReg][addrId] = val;
+    if constexpr (!std::is_null_pointer_v<std::remove_cvref_t<Check>>) {
+        ParseResult pr = scan([&](long long r, long long a, std::string_view v, string& e) { return check(r, a, v, e); });
+        if (!pr.ok) return pr;
     }
-    return {};
+    onHeader(bankId, std::move(title));
+    return scan([&](long long r, long long a, std::string_view v, string&) { onCell(r, a, string(v)); return true; });
+}
+
+template <class OnHeader, class OnCell, class Check = std::nullptr_t>
+inline ParseResult parseBankStream(const std::string& text, const Config& cfg, OnHeader&& onHeader, OnCell&& onCell,
+                                   Check&& check = nullptr) {
+    size_t lineNo = 0;
+    ParseResult pr = parseBankStreamAt(text, cfg, std::forward<OnHeader>(onHeader), std::forward<OnCell>(onCell),
+                                       std::forward<Check>(check), lineNo);
+    if (!pr.ok && !pr.line) pr.line = lineNo;
+    return pr;
+}
+
+// Puts `val` at `addr`, appending in O(1) when keys arrive in ascending order.
+inline void putCellSorted(std::map<long long, string>& m, long long addr, string&& val) {
+    if (m.empty() || std::prev(m.end())->first < addr) m.emplace_hint(m.end(), addr, std::move(val));
+    else m[addr] = std::move(val);
+}
+
+inline ParseResult parseBankText(const std::string& text, const Config& cfg, Bank& outBank) {
+    outBank = {};
+    std::map<long long, string>* reg = nullptr;
+    long long regId = 0;
+    ParseResult pr = parseBankStream(text, cfg,
+        [&](long long id, string&& title) { outBank.id = id; outBank.title = std::move(title); },
+        [&](long long r, long long a, string&& v) {
+            if (!reg || r != regId) { reg = &outBank.regs[r]; regId = r; }
+            putCellSorted(*reg, a, std::move(v));
+        });
+    if (!pr.ok) return pr;
+    for (auto& [r, spec] : pr.types) outBank.decl[r] = spec;
+    string err;
+    if (!applyRegisterTypes(outBank, cfg.inferTypes, err)) return {false, err};
+    return pr;
+}
+
+// Merges bank text into `dst` as the parser produces it. A cursor walks each
+// destination register alongside the (normally ascending) incoming addresses,
+// so a sorted input costs O(n + m) with hinted inserts and moved values. Gaps
+// wider than a few cells and out-of-order addresses fall back to a lower_bound.
+// The text is validated first, including values bound for declared registers:
+// on error `dst` is untouched. Typed registers that receive cells are merged as
+// text and typed again afterwards; declarations in the merged file are ignored.
+struct MergeStats { size_t inserted = 0, updated = 0, unchanged = 0; };
+
+inline ParseResult mergeBankText(const std::string& text, const Config& cfg, Bank& dst, MergeStats& st) {
+    using Cells = std::map<long long, string>;
+    Cells* reg = nullptr;
+    long long regId = 0, lastAddr = 0;
+    Cells::iterator cur;
+    std::vector<long long> touched;
+    ParseResult pr = parseBankStream(text, cfg,
+        [&](long long, string&& title) { if (dst.title.empty()) dst.title = std::move(title); },
+        [&](long long r, long long a, string&& v) {
+            if (!reg || r != regId) {
+                if (dst.cols.count(r)) dst.untype(r);
+                touched.push_back(r);
+                reg = &dst.regs[r]; regId = r;
+                cur = reg->begin(); lastAddr = a;
+            }
+            if (a < lastAddr) cur = reg->lower_bound(a);
+            else {
+                int steps = 0;
+                while (cur != reg->end() && cur->first < a && ++steps <= 8) ++cur;
+                if (steps > 8) cur = reg->lower_bound(a);
+            }
+            lastAddr = a;
+            if (cur != reg->end() && cur->first == a) {
+                if (cur->second == v) ++st.unchanged;
+                else { cur->second = std::move(v); ++st.updated; }
+            } else {
+                cur = reg->emplace_hint(cur, a, std::move(v));
+                ++st.inserted;
+            }
+        },
+        [&](long long r, long long a, std::string_view v, string& err) {
+            auto itD = dst.decl.find(r);
+            if (itD == dst.decl.end() || itD->second.type == ColType::Text) return true;
+            ColSpec spec = itD->second; spec.loose = true;
+            if (colFits(spec, v)) return true;
+            err = "register " + std::to_string(r) + " is declared " + colTypeName(spec) +
+                  " but address " + std::to_string(a) + " holds \"" + string(v.substr(0, 40)) + "\"";
+            return false;
+        });
+    if (!pr.ok) return pr;
+    // Re-type only what this merge touched; the rest keeps its storage.
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    string err;
+    for (long long r : touched) (void)retypeRegister(dst, r, cfg.inferTypes, err);  // declared values were checked above
+    return pr;
 }
 
 inline string writeBankText(const Bank& b, const Config& cfg){
     std::ostringstream os;
     string bankStr = string(1,cfg.prefix) + toBaseN(b.id, cfg.base, cfg.widthBank);
     os << bankStr << "\t(" << b.title << "){\n";
-    bool multi = (b.regs.size()>1) || (b.regs.size()==1 && b.regs.begin()->first!=1);
-    if (!multi){
-        auto it = b.regs.find(1);
-        if (it != b.regs.end()){
-            for (auto& [aid, val] : it->second){
-                os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t" << val << "\n";
-            }
+    std::vector<long long> ids;
+    for (auto& [r, m] : b.regs) ids.push_back(r);
+    for (auto& [r, c] : b.cols) ids.push_back(r);
+    for (auto& [r, d] : b.decl) ids.push_back(r);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    bool multi = (ids.size()>1) || (ids.size()==1 && ids[0]!=1) || !b.decl.empty();
+    string val;
+    for (long long rid : ids){
+        if (multi) {
+            os << toBaseN(rid, cfg.base, cfg.widthReg);
+            if (auto itD = b.decl.find(rid); itD != b.decl.end()) os << " " << colTypeName(itD->second);
+            os << "\n";
         }
-    } else {
-        for (auto& [rid, addrs] : b.regs){
-            os << toBaseN(rid, cfg.base, cfg.widthReg) << "\n";
-            for (auto& [aid, val] : addrs){
-                os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t" << val << "\n";
+        if (auto itR = b.regs.find(rid); itR != b.regs.end()) {
+            for (auto& [aid, v] : itR->second)
+                os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t" << v << "\n";
+        } else if (auto itC = b.cols.find(rid); itC != b.cols.end()) {
+            const Column& c = itC->second;
+            for (size_t k = 0; k < c.size(); ++k) {
+                c.formatTo(k, val);
+                os << "\t" << toBaseN(c.addrAt(k), cfg.base, cfg.widthAddr) << "\t" << val << "\n";
             }
         }
     }
@@ -286,36 +1523,106 @@ inline fs::path outJsonName(const Config& cfg, long long bankId){
     return fs::path("files/out") / (string(1,cfg.prefix) + toBaseN(bankId, cfg.base, cfg.widthBank) + ".json");
 }
 
-inline bool loadContextFile(const Config& cfg, const fs::path& file, Bank& bank, string& err){
+inline bool loadContextFile(const Config& cfg, const fs::path& file, Bank& bank, string& err,
+                            string* warn = nullptr){
     if (!fs::exists(file)) { err = "file not found: " + file.string(); return false; }
     std::ifstream in(file, std::ios::binary);
     if (!in){ err="cannot open: " + file.string(); return false; }
     string text( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
     ParseResult pr = parseBankText(text, cfg, bank);
-    if (!pr.ok) { err = pr.err; return false; }
+    if (!pr.ok) { err = file.string() + (pr.line ? ":" + std::to_string(pr.line) : string()) + ": " + pr.err; return false; }
+    if (warn && !pr.warn.empty()) *warn = file.string() + ": " + pr.warn;
     return true;
 }
+// Temp name next to `path` for one write: pid plus a process-wide counter, so
+// concurrent writers of one target (a :bg job and the REPL, two sessions) never
+// share, and then rename, each other's half-written file.
+inline fs::path tempPathFor(const fs::path& path){
+    static std::atomic<uint64_t> seq{0};
+#if defined(_WIN32)
+    long pid = static_cast<long>(_getpid());
+#else
+    long pid = static_cast<long>(getpid());
+#endif
+    fs::path tmp = path;
+    tmp += ".tmp." + std::to_string(pid) + "." + std::to_string(seq.fetch_add(1));
+    return tmp;
+}
+
+// ----------------------------- Bloom sidecars -----------------------------
+inline fs::path bloomFileName(const fs::path& bankFile){
+    fs::path p = bankFile; p.replace_extension(".bloom");
+    return p;
+}
+inline bool statBankFile(const fs::path& file, uint64_t& size, int64_t& mtime){
+    std::error_code ec;
+    auto sz = fs::file_size(file, ec);             if (ec) return false;
+    auto mt = fs::last_write_time(file, ec);       if (ec) return false;
+    size = sz; mtime = static_cast<int64_t>(mt.time_since_epoch().count());
+    return true;
+}
+// Best effort: a missing or stale sidecar only costs a full load on lookup.
+inline void saveBankBloom(const Config& cfg, const fs::path& bankFile, const Bank& b){
+    BankBloom bf;
+    if (!statBankFile(bankFile, bf.srcSize, bf.srcMtime)) return;
+    bf.layout = BankBloom::layoutOf(cfg);
+    bf.build(b);
+    fs::path side = bloomFileName(bankFile), tmp = tempPathFor(side);
+    std::error_code ec;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        string data = bf.serialize();
+        out.write(data.data(), (std::streamsize)data.size());
+        if (!out) { out.close(); fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, side, ec);
+    if (ec) fs::remove(tmp, ec);
+}
+// Sidecar for a bank that is not loaded, cached in ws.blooms; null if there is
+// none or it no longer matches the bank file or the current parse settings. The
+// bank file is stat'ed on every use, so a cached filter never outlives a rewrite
+// by :w, :farm or another session, nor a :set base/width/prefix.
+inline const BankBloom* bankBloom(const Config& cfg, Workspace& ws, long long bankId){
+    fs::path file = contextFileName(cfg, bankId);
+    uint64_t size, layout = BankBloom::layoutOf(cfg); int64_t mtime;
+    if (!statBankFile(file, size, mtime)) return nullptr;
+    auto it = ws.blooms.find(bankId);
+    if (it != ws.blooms.end() && it->second && (it->second->srcSize != size || it->second->srcMtime != mtime
+                                  || it->second->layout != layout)) {
+        ws.blooms.erase(it);
+        it = ws.blooms.end();
+    }
+    if (it == ws.blooms.end()) {
+        std::optional<BankBloom> got;
+        std::ifstream in(bloomFileName(file), std::ios::binary);
+        if (in) {
+            string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            BankBloom bf;
+            if (bf.parse(data) && bf.srcSize == size && bf.srcMtime == mtime && bf.layout == layout) got = std::move(bf);
+        }
+        it = ws.blooms.emplace(bankId, std::move(got)).first;
+    }
+    return it->second ? &*it->second : nullptr;
+}
+
 // --- saveContextFile: ensure dirs; write atomically-ish -------------------
-inline bool saveContextFile(const Config& cfg,
-                            const std::filesystem::path& path,
-                            const Bank& b,
-                            std::string& err)
-{
+// Writes `data` to a temp file next to `path` and renames it over the target,
+// so readers never see a half-written file.
+inline bool writeFileAtomic(const fs::path& path, const string& data, string& err) {
     try {
-        std::filesystem::create_directories(path.parent_path());
+        if (!path.parent_path().empty()) std::filesystem::create_directories(path.parent_path());
 
         // Write to a temp file first
-        auto tmp = path; tmp += ".tmp";
+        auto tmp = tempPathFor(path);
+        std::error_code ec;
         {
             std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
             if (!out) { err = "Cannot open temp file for write: " + tmp.string(); return false; }
-            std::string text = writeBankText(b, cfg);
-            out.write(text.data(), (std::streamsize)text.size());
-            if (!out) { err = "Write failed: " + tmp.string(); return false; }
+            out.write(data.data(), (std::streamsize)data.size());
+            if (!out) { out.close(); std::filesystem::remove(tmp, ec); err = "Write failed: " + tmp.string(); return false; }
         }
 
         // Replace the target (works across volumes with fallback)
-        std::error_code ec;
         std::filesystem::rename(tmp, path, ec);
         if (ec) {
             std::filesystem::copy_file(tmp, path,
@@ -330,43 +1637,320 @@ inline bool saveContextFile(const Config& cfg,
     }
 }
 
+inline bool saveContextFile(const Config& cfg,
+                            const std::filesystem::path& path,
+                            const Bank& b,
+                            std::string& err)
+{
+    if (!writeFileAtomic(path, writeBankText(b, cfg), err)) return false;
+    saveBankBloom(cfg, path, b);
+    return true;
+}
 
-inline bool ensureBankLoadedInWorkspace(const Config& cfg, Workspace& ws, long long bankId, string& err){
-    if (ws.banks.count(bankId)) return true;
-    fs::path file = contextFileName(cfg, bankId);
-    if (!fs::exists(file)) { err = "missing context file: " + file.string(); return false; }
+
+// ----------------------------- Cold tier -----------------------------
+// Serialized bank: varint title, type declarations, reg count, then per reg its
+// id, storage spec, cell count and (addr delta, length, bytes) per cell; ids are
+// zigzag-encoded.
+namespace detail {
+inline void putVar(string& o, uint64_t v) {
+    for (; v >= 0x80; v >>= 7) o.push_back(static_cast<char>((v & 0x7F) | 0x80));
+    o.push_back(static_cast<char>(v));
+}
+inline bool getVar(std::string_view s, size_t& p, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < s.size() && shift < 64; shift += 7) {
+        uint8_t b = static_cast<uint8_t>(s[p++]);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+inline uint64_t zig(long long v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline long long unzig(uint64_t v) { return static_cast<long long>(v >> 1) ^ -static_cast<long long>(v & 1); }
+inline void putSpec(string& o, const ColSpec& c) {
+    putVar(o, static_cast<uint64_t>(c.type)); putVar(o, c.width);
+    putVar(o, (c.upper ? 1u : 0u) | (c.prefixed ? 2u : 0u) | (c.loose ? 4u : 0u));
+}
+inline bool getSpec(std::string_view s, size_t& p, ColSpec& c) {
+    uint64_t t = 0, w = 0, f = 0;
+    if (!getVar(s, p, t) || !getVar(s, p, w) || !getVar(s, p, f) || t > 3) return false;
+    c.type = static_cast<ColType>(t); c.width = static_cast<uint16_t>(w);
+    c.upper = f & 1; c.prefixed = f & 2; c.loose = f & 4;
+    return true;
+}
+} // namespace detail
+
+inline string serializeBank(const Bank& b, size_t& cells, uint64_t& textBytes) {
+    using detail::putVar; using detail::zig; using detail::putSpec;
+    string o;
+    cells = 0; textBytes = 0;
+    putVar(o, b.title.size()); o += b.title;
+    putVar(o, b.decl.size());
+    for (auto& [r, d] : b.decl) { putVar(o, zig(r)); putSpec(o, d); }
+    putVar(o, b.regCount());
+    long long curReg = 0, prev = 0;
+    bool first = true;
+    // Typed registers go out as text with their spec and are rebuilt on thaw.
+    auto header = [&](long long r, size_t n, const ColSpec& spec) {
+        putVar(o, zig(r)); putSpec(o, spec); putVar(o, n);
+        curReg = r; prev = 0; first = false;
+    };
+    b.forEachCell([&](long long r, long long a, const string& v) {
+        if (first || r != curReg) {
+            auto itC = b.cols.find(r);
+            if (itC != b.cols.end()) header(r, itC->second.size(), itC->second.spec);
+            else header(r, b.regs.at(r).size(), ColSpec{});
+        }
+        putVar(o, zig(a - prev)); prev = a;
+        putVar(o, v.size()); o += v;
+        ++cells; textBytes += v.size();
+    });
+    for (auto& [r, m] : b.regs) if (m.empty()) header(r, 0, ColSpec{});   // keep empty registers
+    return o;
+}
+
+inline bool deserializeBank(std::string_view s, Bank& b) {
+    using detail::getVar; using detail::unzig; using detail::getSpec;
+    size_t p = 0;
+    uint64_t n = 0, nregs = 0, ndecl = 0;
+    if (!getVar(s, p, n) || p + n > s.size()) return false;
+    b.title.assign(s.substr(p, n)); p += n;
+    if (!getVar(s, p, ndecl)) return false;
+    for (uint64_t i = 0; i < ndecl; ++i) {
+        uint64_t r = 0; ColSpec d;
+        if (!getVar(s, p, r) || !getSpec(s, p, d)) return false;
+        b.decl[unzig(r)] = d;
+    }
+    if (!getVar(s, p, nregs)) return false;
+    for (uint64_t i = 0; i < nregs; ++i) {
+        uint64_t r = 0, ncells = 0;
+        ColSpec spec;
+        if (!getVar(s, p, r) || !getSpec(s, p, spec) || !getVar(s, p, ncells)) return false;
+        std::map<long long, string>* dst = nullptr;
+        Column* col = nullptr;
+        if (spec.type == ColType::Text) dst = &b.regs[unzig(r)];
+        else { col = &b.cols[unzig(r)]; col->spec = spec; }
+        long long a = 0;
+        for (uint64_t k = 0; k < ncells; ++k) {
+            uint64_t d = 0, len = 0;
+            if (!getVar(s, p, d) || !getVar(s, p, len) || p + len > s.size()) return false;
+            a += unzig(d);
+            if (dst) dst->emplace_hint(dst->end(), a, string(s.substr(p, len)));
+            else if (!col->push(a, s.substr(p, len))) return false;
+            p += len;
+        }
+        if (col) col->shrink();
+    }
+    return p == s.size();
+}
+
+inline void touchBank(Workspace& ws, long long id) { ws.touched[id] = std::chrono::steady_clock::now(); }
+
+// Moves a loaded bank into the cold tier.
+inline bool freezeBank(Workspace& ws, long long id) {
+    std::lock_guard lk(ws.mu);
+    auto it = ws.banks.find(id);
+    if (it == ws.banks.end()) return false;
+    ColdBank c;
+    string raw = serializeBank(it->second, c.cells, c.textBytes);
+    c.rawSize = raw.size();
+    c.blob = lz::compress(raw);
+    c.blob.shrink_to_fit();
+    c.bloom.build(it->second);
+    ws.cold[id] = std::move(c);
+    ws.banks.erase(it);
+    return true;
+}
+
+// Restores a cold bank into `banks`; the caller holds ws.mu. False if it is not
+// cold, or, with `err` set, if the blob cannot be restored: the blob is kept (it
+// may hold unsaved edits) and the caller must not fall back to the file.
+inline bool thawBank(Workspace& ws, long long id, string& err) {
+    auto it = ws.cold.find(id);
+    if (it == ws.cold.end()) return false;
+    string raw;
     Bank b;
-    if (!loadContextFile(cfg, file, b, err)) return false;
-    ws.banks[bankId] = std::move(b);
-    ws.filenames[bankId] = file.string();
+    if (!lz::decompress(it->second.blob, it->second.rawSize, raw) || !deserializeBank(raw, b)) {
+        err = "cold copy of bank " + std::to_string(id) + " is corrupt; kept in memory, not reloaded from file";
+        return false;
+    }
+    ws.cold.erase(it);
+    b.id = id;
+    ws.banks[id] = std::move(b);
+    touchBank(ws, id);
     return true;
 }
 
+// Freezes loaded banks idle for at least `idle`, except `keep` (the bank being
+// edited). Returns how many were frozen.
+inline size_t freezeIdleBanks(Workspace& ws, std::chrono::steady_clock::duration idle,
+                              std::optional<long long> keep) {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<long long> ids;
+    {
+        std::lock_guard lk(ws.mu);
+        for (auto& [id, b] : ws.banks) {
+            if (keep && *keep == id) continue;
+            auto t = ws.touched.find(id);
+            if (t == ws.touched.end()) { ws.touched[id] = now; continue; } // first seen: start its clock
+            if (now - t->second >= idle) ids.push_back(id);
+        }
+    }
+    for (long long id : ids) freezeBank(ws, id);
+    return ids.size();
+}
+
+// Drops a bank (loaded or cold) from memory; its file is untouched.
+inline void unloadBank(Workspace& ws, long long id) {
+    std::lock_guard lk(ws.mu);
+    ws.banks.erase(id);
+    ws.cold.erase(id);
+    ws.filenames.erase(id);
+    ws.warnings.erase(id);
+    ws.touched.erase(id);
+}
+
+// Threads that miss the same bank at once share one parse through ws.loads;
+// the file is read outside ws.mu so loads of different banks run in parallel.
+inline bool ensureBankLoadedInWorkspace(const Config& cfg, Workspace& ws, long long bankId, string& err){
+    {
+        std::lock_guard lk(ws.mu);
+        if (ws.banks.count(bankId) || thawBank(ws, bankId, err)) { touchBank(ws, bankId); return true; }
+        if (!err.empty()) return false;
+    }
+    auto [ok, e] = ws.loads.run(bankId, [&]() -> std::pair<bool, string> {
+        {
+            std::lock_guard lk(ws.mu);   // a flight that just landed may have loaded it
+            if (ws.banks.count(bankId)) return {true, {}};
+        }
+        fs::path file = contextFileName(cfg, bankId);
+        if (!fs::exists(file)) return {false, "missing context file: " + file.string()};
+        Bank b; string warn, why;
+        if (!loadContextFile(cfg, file, b, why, &warn)) return {false, why};
+        bool staleBloom;
+        {
+            std::lock_guard lk(ws.mu);
+            auto itB = ws.blooms.find(bankId);
+            staleBloom = itB != ws.blooms.end() && !itB->second;
+        }
+        if (staleBloom) saveBankBloom(cfg, file, b);   // missing, or built under other settings
+        std::lock_guard lk(ws.mu);
+        ws.blooms.erase(bankId);
+        ws.banks[bankId] = std::move(b);
+        ws.filenames[bankId] = file.string();
+        if (!warn.empty()) ws.warnings[bankId] = warn;
+        return {true, {}};
+    });
+    if (!ok) err = e;
+    return ok;
+}
+
+// ----------------------------- Resolve tracing -----------------------------
+struct CellKey {
+    long long bank = 0, reg = 1, addr = 0;
+    bool operator==(const CellKey&) const = default;
+};
+struct CellKeyHash {
+    size_t operator()(const CellKey& k) const noexcept {
+        return static_cast<size_t>(BankBloom::mix(BankBloom::hashKey(k.reg, k.addr) ^ static_cast<uint64_t>(k.bank)));
+    }
+};
+
+// Per-cell cost of resolving, gathered by the Resolver as it recurses (set
+// Resolver::trace). A cell's exclusive time is its inclusive time minus that of
+// the references it expanded; `tree` keeps every expansion when keepTree is set.
+struct ResolveTrace {
+    using clock = std::chrono::steady_clock;
+    struct Stats {
+        uint64_t calls = 0, inclNs = 0, exclNs = 0, bytes = 0;
+        uint64_t refs = 0, cycles = 0, missing = 0, includeBytes = 0;
+        void add(const Stats& o) {
+            calls += o.calls; inclNs += o.inclNs; exclNs += o.exclNs; bytes += o.bytes;
+            refs += o.refs; cycles += o.cycles; missing += o.missing; includeBytes += o.includeBytes;
+        }
+    };
+    struct Node { CellKey key; int parent = -1; int depth = 0; Stats s; };
+
+    bool keepTree = false;
+    std::vector<Node> tree;                                   // pre-order
+    std::unordered_map<CellKey, Stats, CellKeyHash> cells;    // summed over every expansion
+
+    void enter(const CellKey& k) {
+        stack_.push_back({k, clock::now(), 0, {}, -1});
+        if (!keepTree) return;
+        int parent = stack_.size() > 1 ? stack_[stack_.size() - 2].node : -1;
+        tree.push_back({k, parent, static_cast<int>(stack_.size()) - 1, {}});
+        stack_.back().node = static_cast<int>(tree.size()) - 1;
+    }
+    void leave(size_t outBytes) {
+        Frame f = stack_.back();
+        stack_.pop_back();
+        uint64_t incl = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - f.t0).count());
+        f.s.calls = 1;
+        f.s.inclNs = incl;
+        f.s.exclNs = incl > f.childNs ? incl - f.childNs : 0;
+        f.s.bytes = outBytes;
+        if (!stack_.empty()) { stack_.back().childNs += incl; ++stack_.back().s.refs; }
+        if (f.node >= 0) tree[static_cast<size_t>(f.node)].s = f.s;
+        cells[f.key].add(f.s);
+    }
+    // Counts an event (cycle, missing cell, include bytes) against the cell being expanded.
+    void tally(uint64_t Stats::* field, uint64_t n = 1) { if (!stack_.empty()) stack_.back().s.*field += n; }
+
+    // The n cells with the most exclusive time.
+    std::vector<std::pair<CellKey, Stats>> top(size_t n) const {
+        std::vector<std::pair<CellKey, Stats>> v(cells.begin(), cells.end());
+        auto cmp = [](const auto& a, const auto& b) { return a.second.exclNs > b.second.exclNs; };
+        if (v.size() > n) { std::partial_sort(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(n), v.end(), cmp); v.resize(n); }
+        else std::sort(v.begin(), v.end(), cmp);
+        return v;
+    }
+
+private:
+    struct Frame { CellKey key; clock::time_point t0; uint64_t childNs; Stats s; int node; };
+    std::vector<Frame> stack_;
+};
+
 // ----------------------------- Resolver (both styles active) -----------------------------
 struct Resolver {
     const Config& cfg;
     Workspace& ws;
-    Resolver(const Config& c, Workspace& w): cfg(c), ws(w) {}
+    const CancelToken* cancel = nullptr;   // checked once per resolve() call
+    ResolveTrace* trace = nullptr;         // per-cell costs (:explain, :resolve --profile)
+    Resolver(const Config& c, Workspace& w, const CancelToken* t = nullptr): cfg(c), ws(w), cancel(t) {}
 
     bool getValue(long long bank, long long reg, long long addr, string& out) const {
         string err;
-        (void)ensureBankLoadedInWorkspace(cfg, const_cast<Workspace&>(ws), bank, err);
+        Workspace& W = const_cast<Workspace&>(ws);
+        if (W.remoteCell) {
+            if (int r = W.remoteCell(bank, reg, addr, out); r >= 0) return r == 1;
+        }
+        {
+            std::lock_guard lk(W.mu);
+            for (auto* r : W.readSinks) r->banks.insert(bank);
+            if (!ws.banks.count(bank)) {
+                // Unloaded or cold bank: let its Bloom filter reject missing keys before a load/thaw.
+                auto itC = ws.cold.find(bank);
+                const BankBloom* bf = itC != ws.cold.end() ? &itC->second.bloom : bankBloom(cfg, W, bank);
+                if (bf && !bf->mayContain(reg, addr)) return false;
+            }
+        }
+        (void)ensureBankLoadedInWorkspace(cfg, W, bank, err);
+        // Copied out under the lock: another thread may freeze or unload the bank.
+        std::lock_guard lk(W.mu);
         auto itB = ws.banks.find(bank);
-        if (itB==ws.banks.end()) return false;
-        const auto& b = itB->second;
-        auto itR = b.regs.find(reg);
-        if (itR==b.regs.end()) return false;
-        auto itA = itR->second.find(addr);
-        if (itA==itR->second.end()) return false;
-        out = itA->second;
-        return true;
+        return itB != ws.banks.end() && itB->second.get(reg, addr, out);
     }
+    void tally(uint64_t ResolveTrace::Stats::* field) const { if (trace) trace->tally(field); }
     bool getValueTwoPart(long long bank, long long addr, string& out) const {
-        string err;
-        (void)ensureBankLoadedInWorkspace(cfg, const_cast<Workspace&>(ws), bank, err);
         return getValue(bank, 1, addr, out);
     }
     string includeFile(const string& name) const {
+        {
+            std::lock_guard lk(ws.mu);
+            for (auto* r : ws.readSinks) r->files.insert(name);
+        }
         fs::path p = fs::path("files") / name;
         if (!fs::exists(p)) return string("[Missing file: ")+name+"]";
         std::ifstream in(p, std::ios::binary);
@@ -374,8 +1958,18 @@ struct Resolver {
         return string( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
     }
 
+    // Expands the value of cell `k`; with a trace, timed as a node of its own.
+    string resolveCell(const string& value, const CellKey& k, std::unordered_set<string>& visited) const {
+        if (!trace) return resolve(value, k.bank, visited);
+        trace->enter(k);
+        string out = resolve(value, k.bank, visited);
+        trace->leave(out.size());
+        return out;
+    }
+
     string resolve(const string& input, long long currentBank, std::unordered_set<string>& visited) const {
         //(void)currentBank;
+        if (cancelled(cancel)) return input;   // caller sees the token and discards the result
         string s = input;
         {   // @file(...)
             static std::regex fileRe(R"(@file\(([^)]+)\))");
@@ -386,7 +1980,9 @@ struct Resolver {
                 size_t len = m.length(0);
                 out.append(s, last, pos - last);
                 string fname = trim(m[1].str());
+                size_t before = out.size();
                 out += includeFile(fname);
+                if (trace) trace->tally(&ResolveTrace::Stats::includeBytes, out.size() - before);
                 searchStart = s.cbegin() + pos + len;
                 last = pos + len;
             }
@@ -407,9 +2003,9 @@ struct Resolver {
                     out += "[BadRef " + m[0].str() + "]";
                 } else {
                     string key = std::to_string(currentBank) + "." + std::to_string(r) + "." + std::to_string(a);
-                    if (visited.count(key)) out += "[Circular Ref: " + m[0].str() + "]";
-                    else { string v; if (!getValue(currentBank,r,a,v)) out += "[Missing " + m[0].str() + "]";
-                        else { auto v2=visited; v2.insert(key); out += resolve(v, currentBank, v2); } }
+                    if (visited.count(key)) { tally(&ResolveTrace::Stats::cycles); out += "[Circular Ref: " + m[0].str() + "]"; }
+                    else { string v; if (!getValue(currentBank,r,a,v)) { tally(&ResolveTrace::Stats::missing); out += "[Missing " + m[0].str() + "]"; }
+                        else { auto v2=visited; v2.insert(key); out += resolveCell(v, {currentBank, r, a}, v2); } }
                 }
                 searchStart = s.cbegin() + pos + len; last = pos + len;
             }
@@ -448,15 +2044,17 @@ struct Resolver {
                         std::string(1, cfg.prefix) + m[1].str() + "." + m[2].str() + "." + m[3].str();
 
                     if (visited.count(key)) {
+                        tally(&ResolveTrace::Stats::cycles);
                         out += "[Circular Ref: " + m[0].str() + "]";
                     } else {
                         std::string v;
                         if (!getValue(b, r, a, v)) {
+                            tally(&ResolveTrace::Stats::missing);
                             out += "[Missing " + m[0].str() + "]";
                         } else {
                             auto v2 = visited;
                             v2.insert(key);
-                            out += resolve(v, b, v2);   // <-- replace the entire token with resolved value
+                            out += resolveCell(v, {b, r, a}, v2);   // <-- replace the entire token with resolved value
                         }
                     }
                 }
@@ -489,11 +2087,11 @@ struct Resolver {
                         out += "[BadRef " + m[0].str() + "]";
                     } else {
                         string key = string(1, pf) + m[2].str() + "." + m[3].str();
-                        if (visited.count(key)) out += "[Circular Ref: " + m[0].str() + "]";
+                        if (visited.count(key)) { tally(&ResolveTrace::Stats::cycles); out += "[Circular Ref: " + m[0].str() + "]"; }
                         else {
                             string v;
-                            if (!getValueTwoPart(b, a, v)) out += "[Missing " + m[0].str() + "]";
-                            else { auto v2=visited; v2.insert(key); out += resolve(v, b, v2); }
+                            if (!getValueTwoPart(b, a, v)) { tally(&ResolveTrace::Stats::missing); out += "[Missing " + m[0].str() + "]"; }
+                            else { auto v2=visited; v2.insert(key); out += resolveCell(v, {b, 1, a}, v2); }
                         }
                     }
                 }
@@ -527,11 +2125,11 @@ struct Resolver {
                 long long r = std::stoll(m[2].str());
                 long long a = std::stoll(m[3].str());
                 string key = std::to_string(b)+"."+std::to_string(r)+"."+std::to_string(a);
-                if (visited.count(key)) out += "[Circular Ref: " + m[0].str() + "]";
+                if (visited.count(key)) { tally(&ResolveTrace::Stats::cycles); out += "[Circular Ref: " + m[0].str() + "]"; }
                 else {
                     string v;
-                    if (!getValue(b, r, a, v)) out += "[Missing " + m[0].str() + "]";
-                    else { auto v2=visited; v2.insert(key); out += resolve(v, b, v2); }
+                    if (!getValue(b, r, a, v)) { tally(&ResolveTrace::Stats::missing); out += "[Missing " + m[0].str() + "]"; }
+                    else { auto v2=visited; v2.insert(key); out += resolveCell(v, {b, r, a}, v2); }
                 }
                 searchStart = s.cbegin() + pos + len; last = pos + len;
             }
@@ -545,14 +2143,14 @@ struct Resolver {
 
 // ----------------------------- Config file helpers -----------------------------
 inline void ensurePaths(const Paths& P){ P.ensure(); }
-inline Config loadConfig(const Paths& P){
+// writeDefaults=false (one-shot -c runs) leaves a missing config.json uncreated.
+inline Config loadConfig(const Paths& P, bool writeDefaults = true){
     ensurePaths(P);
     Config cfg;
-    if (fs::exists(P.config)) {
-        std::ifstream in(P.config);
+    if (std::ifstream in{P.config}) {
         string j( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
         cfg = Config::fromJSON(j);
-    } else {
+    } else if (writeDefaults) {
         std::ofstream out(P.config);
         out << cfg.toJSON();
     }
@@ -586,6 +2184,9 @@ inline bool openCtx(const Config& cfg,
     auto path = contextFileName(cfg, id);
     Bank b;
 
+    ws.cold.erase(id);     // :open re-reads the file, same as for a loaded bank
+    touchBank(ws, id);
+
     if (std::filesystem::exists(path)) {
         // OPEN FOR READING ONLY — opening must NOT fail if file is read-only
         std::ifstream in(path, std::ios::binary);
@@ -596,6 +2197,7 @@ inline bool openCtx(const Config& cfg,
         if (b.title.empty()) b.title = stem;
         ws.banks[id] = std::move(b);
         status = "Opened " + path.string();
+        if (!pr.warn.empty()) { ws.warnings[id] = pr.warn; status += " (" + pr.warn + ")"; }
         return true;
     }
 
@@ -616,65 +2218,217 @@ inline bool openCtx(const Config& cfg,
     return true;
 }
 
+// ----------------------------- Multi-get -----------------------------
+
+// Parses "x00001.02.0003", or "x00001.0003" for register 1, in cfg's prefix and base.
+inline bool parseCellId(const Config& cfg, std::string_view id, CellKey& k) {
+    id = trimView(id);
+    if (id.size() < 2 || id[0] != cfg.prefix) return false;
+    id.remove_prefix(1);
+    string part[3]; int n = 0;
+    for (;;) {
+        if (n == 3) return false;
+        auto dot = id.find('.');
+        part[n++] = string(id.substr(0, dot));
+        if (dot == std::string_view::npos) break;
+        id.remove_prefix(dot + 1);
+    }
+    if (n < 2 || !parseIntBase(part[0], cfg.base, k.bank)) return false;
+    k.reg = 1;
+    if (n == 3 && !parseIntBase(part[1], cfg.base, k.reg)) return false;
+    return parseIntBase(part[n - 1], cfg.base, k.addr);
+}
 
-inline string resolveBankToText(const Config& cfg, Workspace& ws, long long bankId){
-    Resolver R(cfg, ws);
+// Values of many cells in request order, packed into one buffer.
+struct CellBatch {
+    string data;
+    std::vector<size_t>  end;     // value i is data[end[i-1], end[i])
+    std::vector<uint8_t> found;
+    size_t banks = 0;             // distinct banks the keys named
+
+    size_t size() const { return end.size(); }
+    std::string_view value(size_t i) const {
+        size_t b = i ? end[i - 1] : 0;
+        return std::string_view(data).substr(b, end[i] - b);
+    }
+};
+
+// Looks up `keys` sorted by (bank, reg, addr): each bank is loaded, thawed or
+// rejected by its Bloom filter once, and each text register is walked with a
+// cursor instead of a fresh map search per key. With `resolve`, values are
+// expanded as :resolve would. Returns false if `cancel` fired.
+inline bool mget(const Config& cfg, Workspace& ws, const std::vector<CellKey>& keys, CellBatch& out,
+                 bool resolve = false, const CancelToken* cancel = nullptr) {
+    const size_t n = keys.size();
+    struct Slot { CellKey k; size_t idx; };   // sorted by value, not through an index
+    std::vector<Slot> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = {keys[i], i};
+    std::sort(order.begin(), order.end(), [](const Slot& x, const Slot& y) {
+        return std::tie(x.k.bank, x.k.reg, x.k.addr) < std::tie(y.k.bank, y.k.reg, y.k.addr);
+    });
+
+    // Pass 1: values in key order into a scratch buffer.
+    constexpr size_t kMissing = std::numeric_limits<size_t>::max();
+    std::vector<std::pair<size_t, size_t>> span(n, {0, kMissing});   // offset, length
+    string scratch;
+    Resolver R(cfg, ws, cancel);
+    string tmp;
+    // Values are copied out while ws.mu is held: once it is released another
+    // thread (:bg, idle cold-tiering) may freeze the bank. Resolving takes the
+    // lock itself, so it works on copies after the bank's group is read.
+    std::vector<std::pair<size_t, string>> pending;
+    auto emit = [&](size_t idx, std::string_view v) {
+        if (resolve) { pending.emplace_back(idx, string(v)); return; }
+        span[idx] = {scratch.size(), v.size()};
+        scratch.append(v);
+    };
+    out.banks = 0;
+    for (size_t i = 0; i < n; ) {
+        if (cancelled(cancel)) return false;
+        const long long bank = order[i].k.bank;
+        size_t j = i;
+        while (j < n && order[j].k.bank == bank) ++j;
+        ++out.banks;
+
+        bool skip = false;
+        {
+            std::lock_guard lk(ws.mu);
+            if (!ws.banks.count(bank)) {
+                auto itC = ws.cold.find(bank);
+                const BankBloom* bf = itC != ws.cold.end() ? &itC->second.bloom : bankBloom(cfg, ws, bank);
+                skip = bf && std::none_of(order.begin() + std::ptrdiff_t(i), order.begin() + std::ptrdiff_t(j),
+                                          [&](const Slot& o) { return bf->mayContain(o.k.reg, o.k.addr); });
+            }
+        }
+        string err;
+        std::unique_lock lk(ws.mu, std::defer_lock);
+        const Bank* B = nullptr;
+        if (!skip && ensureBankLoadedInWorkspace(cfg, ws, bank, err)) {
+            lk.lock();
+            if (!ws.banks.count(bank)) thawBank(ws, bank, err);   // frozen again since it was loaded
+            if (auto it = ws.banks.find(bank); it != ws.banks.end()) B = &it->second;
+        }
+        for (size_t r0 = i; B && r0 < j; ) {
+            const long long reg = order[r0].k.reg;
+            size_t r1 = r0;
+            while (r1 < j && order[r1].k.reg == reg) ++r1;
+            if (auto itR = B->regs.find(reg); itR != B->regs.end()) {
+                const auto& m = itR->second;
+                auto it = m.begin();
+                for (size_t k = r0; k < r1; ++k) {
+                    const long long a = order[k].k.addr;
+                    for (int step = 0; step < 8 && it != m.end() && it->first < a; ++step) ++it;
+                    if (it != m.end() && it->first < a) it = m.lower_bound(a);
+                    if (it != m.end() && it->first == a) emit(order[k].idx, it->second);
+                }
+            } else if (auto itC = B->cols.find(reg); itC != B->cols.end()) {
+                size_t pos;
+                for (size_t k = r0; k < r1; ++k)
+                    if (itC->second.find(order[k].k.addr, pos)) { itC->second.formatTo(pos, tmp); emit(order[k].idx, tmp); }
+            }
+            r0 = r1;
+        }
+        if (lk.owns_lock()) lk.unlock();
+        for (auto& [idx, v] : pending) {
+            std::unordered_set<string> visited;
+            span[idx].first = scratch.size();
+            scratch += R.resolve(v, bank, visited);
+            span[idx].second = scratch.size() - span[idx].first;
+        }
+        pending.clear();
+        i = j;
+    }
+    if (cancelled(cancel)) return false;
+
+    // Pass 2: request order.
+    out.data.clear();
+    out.data.reserve(scratch.size());
+    out.end.resize(n);
+    out.found.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (span[i].second != kMissing) {
+            out.found[i] = 1;
+            out.data.append(scratch, span[i].first, span[i].second);
+        }
+        out.end[i] = out.data.size();
+    }
+    return true;
+}
+
+// Exporters return false (and leave `text` unspecified) when `cancel` fires
+// part-way; callers must not write anything in that case. With `index`, they
+// also record where each cell's value lands in `text` (see scripted_outidx.hpp).
+inline bool resolveBankToText(const Config& cfg, Workspace& ws, long long bankId, string& text,
+                              const CancelToken* cancel = nullptr, std::vector<outidx::Entry>* index = nullptr,
+                              ResolveTrace* trace = nullptr){
+    Resolver R(cfg, ws, cancel);
+    R.trace = trace;
     auto& b = ws.banks[bankId];
     std::ostringstream os;
     string bankStr = string(1,cfg.prefix) + toBaseN(b.id, cfg.base, cfg.widthBank);
     os << bankStr << "\t(" << b.title << "){\n";
-    for (auto& [rid, addrs] : b.regs){
-        if (b.regs.size()>1) os << toBaseN(rid, cfg.base, cfg.widthReg) << "\n";
-        for (auto& [aid, val] : addrs){
-            std::unordered_set<string> visited;
-            string out = R.resolve(val, b.id, visited);
-            os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t" << out << "\n";
-        }
-    }
+    const bool multi = b.regCount() > 1;
+    long long prevReg = 0; bool first = true;
+    bool stopped = false;
+    b.forEachCell([&](long long rid, long long aid, const string& val){
+        if (stopped || (stopped = cancelled(cancel))) return;
+        if (multi && (first || rid != prevReg)) os << toBaseN(rid, cfg.base, cfg.widthReg) << "\n";
+        first = false; prevReg = rid;
+        std::unordered_set<string> visited;
+        string out = R.resolveCell(val, {b.id, rid, aid}, visited);
+        os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t";
+        if (index) index->push_back({rid, aid, static_cast<uint64_t>(os.tellp()), out.size()});
+        os << out << "\n";
+    });
+    if (stopped || cancelled(cancel)) return false;
     os << "}\n";
-    return os.str();
+    text = os.str();
+    return true;
 }
 
-inline string exportBankToJSON(const Config& cfg, Workspace& ws, long long bankId){
-    Resolver R(cfg, ws);
+inline bool exportBankToJSON(const Config& cfg, Workspace& ws, long long bankId, string& text,
+                             const CancelToken* cancel = nullptr, std::vector<outidx::Entry>* index = nullptr){
+    Resolver R(cfg, ws, cancel);
     auto& b = ws.banks[bankId];
     std::ostringstream os;
     os << "{\n";
     os << "  \"bank\": \""<< cfg.prefix<<toBaseN(b.id,cfg.base,cfg.widthBank) <<"\",\n";
-    os << "  \"title\": \""<< b.title <<"\",\n";
+    os << "  \"title\": \""<< jsonEscape(b.title) <<"\",\n";
     os << "  \"registers\": [\n";
-    bool firstR=true;
-    for (auto& [rid, addrs] : b.regs){
-        if (!firstR) { os << ",\n"; }
-	firstR=false;
-        os << "    {\"id\":\""<<toBaseN(rid,cfg.base,cfg.widthReg)<<"\",\"addresses\":[\n";
-        bool firstA=true;
-        for (auto& [aid, val] : addrs){
-            if (!firstA) { os << ",\n"; }
-            firstA=false;
-            std::unordered_set<string> visited;
-            string out = R.resolve(val, b.id, visited);
-            auto esc = [](const string& s){
-                string r; r.reserve(s.size()*11/10 + 8);
-                for (char c: s){
-                    if (c=='\\' || c=='"') { r.push_back('\\'); r.push_back(c); }
-                    else if (c=='\n') { r += "\\n"; }
-                    else r.push_back(c);
-                }
-                return r;
-            };
-            os << "      {\"id\":\""<<toBaseN(aid,cfg.base,cfg.widthAddr)
-               <<"\",\"value\":\""<<esc(out)<<"\"}";
+    bool firstR=true, firstA=true;
+    long long prevReg=0;
+    string line;
+    bool stopped = false;
+    b.forEachCell([&](long long rid, long long aid, const string& val){
+        if (stopped || (stopped = cancelled(cancel))) return;
+        if (firstR || rid != prevReg) {
+            if (!firstR) { os << "\n    ]},\n"; }
+            firstR=false; firstA=true; prevReg=rid;
+            os << "    {\"id\":\""<<toBaseN(rid,cfg.base,cfg.widthReg)<<"\",\"addresses\":[\n";
         }
-        os << "\n    ]}";
-    }
+        if (!firstA) { os << ",\n"; }
+        firstA=false;
+        std::unordered_set<string> visited;
+        string out = R.resolve(val, b.id, visited);
+        line.assign("      {\"id\":\"").append(toBaseN(aid,cfg.base,cfg.widthAddr)).append("\",\"value\":\"");
+        size_t v0 = line.size();
+        jsonEscapeAppend(line, out);
+        if (index) index->push_back({rid, aid, static_cast<uint64_t>(os.tellp()) + v0, line.size() - v0});
+        line.append("\"}");
+        os << line;
+    });
+    if (stopped || cancelled(cancel)) return false;
+    if (!firstR) os << "\n    ]}";
     os << "\n  ]\n";
     os << "}\n";
-    return os.str();
+    text = os.str();
+    return true;
 }
 
-inline void preloadAll(const Config& cfg, Workspace& ws){
+// Returns false if `cancel` stopped it early; banks already loaded stay loaded.
+inline bool preloadAll(const Config& cfg, Workspace& ws, const CancelToken* cancel = nullptr){
     for (auto& entry : fs::directory_iterator("files")){
+        if (cancelled(cancel)) return false;
         if (!entry.is_regular_file()) continue;
         auto p = entry.path();
         if (p.extension() != ".txt") continue;
@@ -684,6 +2438,220 @@ inline void preloadAll(const Config& cfg, Workspace& ws){
         if (!parseIntBase(stem.substr(1), cfg.base, id)) continue;
         string err; (void)ensureBankLoadedInWorkspace(cfg, ws, id, err);
     }
+    return true;
+}
+
+// ----------------------------- Memory accounting -----------------------------
+// Estimates what each bank costs on the heap. Node sizes follow libstdc++'s
+// red-black tree (32-byte header + value) and strings spill to the heap past
+// 15 bytes; every allocation is rounded to glibc's 16-byte chunk classes.
+inline size_t heapChunk(size_t n) { return std::max<size_t>(32, (n + 8 + 15) & ~size_t(15)); }
+inline size_t stringHeap(const string& s) { return s.capacity() > 15 ? heapChunk(s.capacity() + 1) : 0; }
+
+struct BankMemory {
+    long long id = 0;
+    size_t   regs = 0, cells = 0;
+    uint64_t payload = 0;    // bytes of cell text
+    uint64_t slack = 0;      // string capacity beyond size (heap strings only)
+    uint64_t nodes = 0;      // map nodes incl. the in-node string headers
+    uint64_t strings = 0;    // heap blocks behind long strings
+    uint64_t columns = 0;    // packed arrays of typed registers
+    uint64_t sidecar = 0;    // bloom sidecar held for the bank, plus diagnostics
+    uint64_t cold = 0;       // compressed blob + bloom of a cold-tier bank
+    bool     isCold = false;
+    uint64_t total() const { return nodes + strings + columns + sidecar + cold; }
+    uint64_t overhead() const { return total() > payload ? total() - payload : 0; }
+};
+
+inline BankMemory bankMemory(const Workspace& ws, long long id) {
+    BankMemory m; m.id = id;
+    constexpr size_t kRegNode  = 32 + sizeof(std::pair<const long long, std::map<long long, string>>);
+    constexpr size_t kCellNode = 32 + sizeof(std::pair<const long long, string>);
+    if (auto it = ws.banks.find(id); it != ws.banks.end()) {
+        const Bank& b = it->second;
+        m.strings += stringHeap(b.title);
+        for (auto& [r, addrs] : b.regs) {
+            ++m.regs;
+            m.nodes += heapChunk(kRegNode);
+            for (auto& [a, v] : addrs) {
+                ++m.cells;
+                m.payload += v.size();
+                m.nodes += heapChunk(kCellNode);
+                if (size_t h = stringHeap(v)) { m.strings += h; m.slack += v.capacity() - v.size(); }
+            }
+        }
+        constexpr size_t kColNode = 32 + sizeof(std::pair<const long long, Column>);
+        for (auto& [r, c] : b.cols) {
+            ++m.regs;
+            m.cells += c.size();
+            m.nodes += heapChunk(kColNode);
+            string v;
+            for (size_t k = 0; k < c.size(); ++k) { c.formatTo(k, v); m.payload += v.size(); }
+            auto arr = [](const auto& vec) -> uint64_t { return vec.capacity() ? heapChunk(vec.capacity() * sizeof(vec[0])) : 0; };
+            m.columns += arr(c.addrs) + arr(c.i64) + arr(c.f64) + arr(c.bytes);
+        }
+    }
+    if (auto it = ws.cold.find(id); it != ws.cold.end()) {
+        const ColdBank& c = it->second;
+        m.isCold = true;
+        m.cells = c.cells;
+        m.payload = c.textBytes;
+        m.cold = heapChunk(c.blob.capacity() + 1) + heapChunk(c.bloom.bits.capacity() * 8) + heapChunk(32 + sizeof(ColdBank) + 8);
+    }
+    if (auto it = ws.blooms.find(id); it != ws.blooms.end() && it->second)
+        m.sidecar += heapChunk(it->second->bits.capacity() * 8);
+    if (auto it = ws.warnings.find(id); it != ws.warnings.end()) m.sidecar += stringHeap(it->second);
+    if (auto it = ws.filenames.find(id); it != ws.filenames.end()) m.sidecar += stringHeap(it->second);
+    return m;
+}
+
+// Banks with loaded text, a cold blob or a cached sidecar, largest first.
+inline std::vector<BankMemory> workspaceMemory(const Workspace& ws) {
+    std::vector<long long> ids;
+    for (auto& [id, b] : ws.banks) ids.push_back(id);
+    for (auto& [id, c] : ws.cold) ids.push_back(id);
+    for (auto& [id, bl] : ws.blooms) if (!ws.banks.count(id) && !ws.cold.count(id)) ids.push_back(id);
+    std::vector<BankMemory> out;
+    for (long long id : ids) out.push_back(bankMemory(ws, id));
+    std::sort(out.begin(), out.end(), [](auto& a, auto& b){ return a.total() > b.total(); });
+    return out;
+}
+
+// Resident set size in bytes (0 where unknown).
+inline uint64_t processRss() {
+#if defined(__linux__)
+    std::ifstream f("/proc/self/statm");
+    uint64_t pages = 0, resident = 0;
+    if (f >> pages >> resident) return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+// Heap bytes the allocator holds but has not handed out (0 where unknown).
+inline uint64_t heapFreeBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.fordblks;
+#else
+    return 0;
+#endif
+}
+
+// Re-allocates a bank's cells in key order into fresh, exactly sized storage.
+// Fragmented: heap strings carry > 1/8 of the payload as unused capacity.
+inline bool bankFragmented(const BankMemory& m) { return m.slack * 8 > m.payload; }
+inline void compactBank(Bank& b) {
+    Bank fresh;
+    fresh.id = b.id;
+    fresh.title = string(b.title);
+    fresh.decl = b.decl;
+    for (auto& [r, addrs] : b.regs) {
+        auto& dst = fresh.regs.emplace_hint(fresh.regs.end(), r, std::map<long long, string>{})->second;
+        for (auto& [a, v] : addrs) dst.emplace_hint(dst.end(), a, string(v));
+    }
+    for (auto& [r, c] : b.cols) fresh.cols.emplace_hint(fresh.cols.end(), r, c);  // vector copies are exact-sized
+    b = std::move(fresh); // old nodes are freed here, leaving whole pages for releaseHeap()
+}
+
+// Returns freed heap pages to the OS where the allocator supports it.
+inline void releaseHeap() {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+// ----------------------------- Register aggregates -----------------------------
+// count/sum/min/max over the cells of one register within [from, to]. Typed
+// columns are reduced straight off their packed arrays (the inner loops are
+// plain and branch-free so the compiler can vectorise them); text registers
+// parse each value and skip the non-numeric ones.
+struct Aggregate {
+    size_t   count = 0, skipped = 0;
+    bool     integral = false;   // int64 column: isum/imin/imax are exact
+    bool     overflow = false;   // int64 sum overflowed; dsum holds the approximation
+    int64_t  isum = 0, imin = 0, imax = 0;
+    double   dsum = 0, dmin = 0, dmax = 0;
+    double   mean() const { return count ? (integral && !overflow ? double(isum) : dsum) / double(count) : 0; }
+};
+
+namespace detail {
+inline void reduceInt(const int64_t* p, size_t n, Aggregate& g) {
+    // Four lanes, as in reduceDouble: a fixed-width body is what -O2's cheap
+    // vectoriser (GCC 12+) accepts; a plain loop only vectorises at -O3.
+    uint64_t s[4] = {0, 0, 0, 0};                     // wraps instead of UB; checked below
+    int64_t mnl[4], mxl[4];
+    for (int j = 0; j < 4; ++j) { mnl[j] = std::numeric_limits<int64_t>::max(); mxl[j] = std::numeric_limits<int64_t>::min(); }
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int j = 0; j < 4; ++j) {
+            int64_t v = p[i + j];
+            s[j] += static_cast<uint64_t>(v);
+            mnl[j] = v < mnl[j] ? v : mnl[j];
+            mxl[j] = v > mxl[j] ? v : mxl[j];
+        }
+    for (; i < n; ++i) { s[0] += static_cast<uint64_t>(p[i]); mnl[0] = std::min(mnl[0], p[i]); mxl[0] = std::max(mxl[0], p[i]); }
+    uint64_t sum = (s[0] + s[1]) + (s[2] + s[3]);
+    int64_t mn = std::min(std::min(mnl[0], mnl[1]), std::min(mnl[2], mnl[3]));
+    int64_t mx = std::max(std::max(mxl[0], mxl[1]), std::max(mxl[2], mxl[3]));
+    g.integral = true;
+    g.count = n; g.imin = mn; g.imax = mx;
+    g.isum = static_cast<int64_t>(sum);
+    g.dsum = double(g.isum); g.dmin = double(mn); g.dmax = double(mx);
+    // The wrapped sum is exact unless n * max|v| can leave int64; recheck wide then.
+    auto mag = [](int64_t v) { return v < 0 ? uint64_t(0) - uint64_t(v) : uint64_t(v); };
+    if (n && std::max(mag(mn), mag(mx)) > uint64_t(std::numeric_limits<int64_t>::max()) / n) {
+        long double ls = 0;
+        for (size_t i = 0; i < n; ++i) ls += p[i];
+        g.overflow = ls > (long double)std::numeric_limits<int64_t>::max() ||
+                     ls < (long double)std::numeric_limits<int64_t>::min();
+        if (g.overflow) g.dsum = double(ls);
+    }
+}
+
+inline void reduceDouble(const double* p, size_t n, Aggregate& g) {
+    // Four independent lanes: reassociating the sum is what lets it vectorise.
+    double s[4] = {0, 0, 0, 0};
+    double mn[4], mx[4];
+    for (int j = 0; j < 4; ++j) { mn[j] = std::numeric_limits<double>::infinity(); mx[j] = -mn[j]; }
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int j = 0; j < 4; ++j) {
+            double v = p[i + j];
+            s[j] += v;
+            mn[j] = v < mn[j] ? v : mn[j];
+            mx[j] = v > mx[j] ? v : mx[j];
+        }
+    for (; i < n; ++i) { s[0] += p[i]; mn[0] = std::min(mn[0], p[i]); mx[0] = std::max(mx[0], p[i]); }
+    g.count = n;
+    g.dsum = (s[0] + s[1]) + (s[2] + s[3]);
+    g.dmin = std::min(std::min(mn[0], mn[1]), std::min(mn[2], mn[3]));
+    g.dmax = std::max(std::max(mx[0], mx[1]), std::max(mx[2], mx[3]));
+}
+} // namespace detail
+
+inline bool aggregateRegister(const Bank& b, long long reg, long long from, long long to, Aggregate& g, string& err) {
+    g = {};
+    if (auto itC = b.cols.find(reg); itC != b.cols.end()) {
+        const Column& c = itC->second;
+        size_t lo = c.lowerBound(from), hi = std::max(lo, c.upperBound(to));
+        if (c.spec.type == ColType::Int64) detail::reduceInt(c.i64.data() + lo, hi - lo, g);
+        else if (c.spec.type == ColType::Float64) detail::reduceDouble(c.f64.data() + lo, hi - lo, g);
+        else g.skipped = hi - lo;                     // hex words are not numbers
+        return true;
+    }
+    auto itR = b.regs.find(reg);
+    if (itR == b.regs.end()) { err = "no register " + std::to_string(reg); return false; }
+    std::vector<double> vals;
+    for (auto it = itR->second.lower_bound(from); it != itR->second.end() && it->first <= to; ++it) {
+        double d;
+        auto r = std::from_chars(it->second.data(), it->second.data() + it->second.size(), d);
+        if (it->second.empty() || r.ec != std::errc{} || r.ptr != it->second.data() + it->second.size()) { ++g.skipped; continue; }
+        vals.push_back(d);
+    }
+    size_t skipped = g.skipped;
+    detail::reduceDouble(vals.data(), vals.size(), g);
+    g.skipped = skipped;
+    return true;
 }
 
 } // namespace scripted
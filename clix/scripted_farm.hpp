@@ -0,0 +1,362 @@
+// scripted_farm.hpp — multi-process resolve farm (`:farm`)
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// The coordinator (the CLI) splits the selected banks into N contiguous id
+// ranges of about equal cost and forks one worker per range. A worker loads only
+// its own banks and resolves each to files/out/<ctx>.resolved.txt (atomically,
+// optionally with a .idx). Cells of banks another worker owns are fetched on
+// demand: worker a holds one socket per peer b for its queries, and a server
+// thread in b answers them from b's banks. A query is (bank, reg, addr) and the
+// answer is the raw value, so each worker resolves exactly as a single process
+// would, cycle detection included; answers are cached up to kCacheBytes.
+// Workers report milliseconds per bank; those go to files/out/farm-costs.tsv and
+// balance the next run (banks never measured are estimated from file size).
+// The farm reads bank files, so unsaved edits in the CLI are not seen. POSIX only.
+#pragma once
+#include "scripted_core.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <cerrno>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/resource.h>
+    #include <sys/socket.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+namespace scripted {
+namespace farm {
+
+using std::string;
+
+struct Options {
+    int  workers = 2;
+    bool index = false;                                 // also write .idx sidecars
+    std::vector<std::pair<long long, fs::path>> banks;  // bank files, sorted by id
+};
+
+struct WorkerReport {
+    long long first = 0, last = 0;   // id range owned
+    size_t    banks = 0, done = 0, failed = 0;
+    size_t    peerLost = 0;          // of `failed`: a peer could not be asked for a cell
+    double    estMs = 0;             // planned cost of the range
+    double    busyMs = 0;            // measured resolve time
+    uint64_t  asked = 0, served = 0; // cross-partition cells fetched / answered
+    long      rssKb = 0;
+    bool      finished = false;      // reported back (did not crash)
+    bool      cancelled = false;
+};
+
+struct Report {
+    std::vector<WorkerReport> workers;
+    double wallSec = 0;
+};
+
+inline fs::path costsPath() { return fs::path("files/out/farm-costs.tsv"); }
+
+// stem -> ms from earlier runs.
+inline std::map<string, double> loadCosts() {
+    std::map<string, double> m;
+    std::ifstream in(costsPath(), std::ios::binary);
+    for (string l; std::getline(in, l); ) {
+        auto tab = l.find('\t');
+        if (tab == string::npos) continue;
+        try { m[l.substr(0, tab)] = std::stod(l.substr(tab + 1)); } catch (...) {}
+    }
+    return m;
+}
+
+// Cuts `cost` (in id order) into at most n contiguous, non-empty [begin, end)
+// ranges whose sums are as close to total/n as a greedy left-to-right split gets.
+inline std::vector<std::pair<size_t, size_t>> partition(const std::vector<double>& cost, size_t n) {
+    std::vector<std::pair<size_t, size_t>> parts;
+    n = std::min(n, cost.size());
+    if (n == 0) return parts;
+    double total = 0;
+    for (double c : cost) total += c;
+    double acc = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < cost.size(); ++i) {
+        acc += cost[i];
+        size_t left = n - parts.size() - 1;                 // ranges still to cut after this one
+        bool mustCut = cost.size() - (i + 1) == left;       // keep one bank for each of them
+        if (left > 0 && (mustCut || acc >= total * double(parts.size() + 1) / double(n))) {
+            parts.emplace_back(begin, i + 1);
+            begin = i + 1;
+        }
+    }
+    parts.emplace_back(begin, cost.size());
+    return parts;
+}
+
+#if !defined(_WIN32)
+namespace detail {
+inline constexpr size_t kCacheBytes = 64u << 20;
+
+inline bool writeAll(int fd, const void* p, size_t n) {
+    auto* c = static_cast<const char*>(p);
+    while (n) {
+        ssize_t w = ::write(fd, c, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        c += w; n -= size_t(w);
+    }
+    return true;
+}
+inline bool readAll(int fd, void* p, size_t n) {
+    auto* c = static_cast<char*>(p);
+    while (n) {
+        ssize_t r = ::read(fd, c, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        c += r; n -= size_t(r);
+    }
+    return true;
+}
+
+// Answers peers' queries from this worker's banks until `stopFd` closes.
+inline void serve(const Config& cfg, Workspace& ws, std::vector<int> fds, int stopFd, std::atomic<uint64_t>& served) {
+    Resolver R(cfg, ws);
+    std::vector<pollfd> pf;
+    for (;;) {
+        pf.clear();
+        pf.push_back({stopFd, POLLIN, 0});
+        for (int fd : fds) pf.push_back({fd, POLLIN, 0});
+        if (::poll(pf.data(), pf.size(), -1) < 0) { if (errno == EINTR) continue; return; }
+        if (pf[0].revents) return;
+        for (size_t i = 1; i < pf.size(); ++i) {
+            if (!pf[i].revents) continue;
+            int64_t q[3];
+            if (!readAll(pf[i].fd, q, sizeof(q))) { fds.erase(std::find(fds.begin(), fds.end(), pf[i].fd)); break; }
+            string v;
+            int64_t len = R.getValue(q[0], q[1], q[2], v) ? int64_t(v.size()) : -1;
+            if (!writeAll(pf[i].fd, &len, sizeof(len)) || (len > 0 && !writeAll(pf[i].fd, v.data(), v.size()))) {
+                fds.erase(std::find(fds.begin(), fds.end(), pf[i].fd));
+                break;
+            }
+            ++served;
+        }
+    }
+}
+
+struct Range { long long lo, hi; };
+
+// Body of worker `self`: resolves its banks and reports them on `resFd` up to the
+// "stats" line, serves peers until `stopFd` closes, then sends "served" and "end".
+inline void work(const Config& cfg, const CancelToken* cancel, const Options& opt, const std::vector<Range>& ranges,
+                 size_t self, size_t begin, size_t end, const std::vector<int>& queryFd,
+                 const std::vector<int>& serveFds, int resFd, int stopFd) {
+    Workspace ws;
+    ::signal(SIGPIPE, SIG_IGN);   // a dead peer shows up as a failed write
+    std::unordered_map<CellKey, std::pair<bool, string>, CellKeyHash> cache;
+    size_t cacheBytes = 0;
+    uint64_t asked = 0;
+    std::vector<char> peerDown(ranges.size(), 0);
+    bool lostPeer = false;   // this bank needed a cell no peer could answer
+    ws.remoteCell = [&](long long bank, long long reg, long long addr, string& out) -> int {
+        size_t owner = ranges.size();
+        for (size_t k = 0; k < ranges.size(); ++k) if (bank >= ranges[k].lo && bank <= ranges[k].hi) { owner = k; break; }
+        if (owner == ranges.size() || owner == self) return -1;
+        CellKey key{bank, reg, addr};
+        if (auto it = cache.find(key); it != cache.end()) { out = it->second.second; return it->second.first; }
+        int64_t q[3] = {bank, reg, addr}, len = -1;
+        string v;
+        // Not an answer: the bank fails rather than print this cell as [Missing].
+        auto down = [&] { peerDown[owner] = 1; lostPeer = true; return 0; };
+        if (peerDown[owner] || queryFd[owner] < 0) return down();
+        if (!writeAll(queryFd[owner], q, sizeof(q)) || !readAll(queryFd[owner], &len, sizeof(len))) return down();
+        if (len > 0) { v.resize(size_t(len)); if (!readAll(queryFd[owner], v.data(), v.size())) return down(); }
+        ++asked;
+        if (cacheBytes > kCacheBytes) { cache.clear(); cacheBytes = 0; }
+        cacheBytes += v.size() + 64;
+        out = v;
+        cache.emplace(key, std::make_pair(len >= 0, std::move(v)));
+        return len >= 0;
+    };
+
+    // Every owned bank is resident before the server starts, so it only reads.
+    string report, err;
+    for (size_t i = begin; i < end; ++i) (void)ensureBankLoadedInWorkspace(cfg, ws, opt.banks[i].first, err);
+    std::atomic<uint64_t> served{0};
+    std::thread server(serve, std::cref(cfg), std::ref(ws), serveFds, stopFd, std::ref(served));
+
+    for (size_t i = begin; i < end && !cancelled(cancel); ++i) {
+        long long id = opt.banks[i].first;
+        string stem = opt.banks[i].second.stem().string(), text;
+        std::vector<outidx::Entry> index;
+        auto t0 = std::chrono::steady_clock::now();
+        lostPeer = false;
+        bool ok = ws.banks.count(id) && resolveBankToText(cfg, ws, id, text, cancel, opt.index ? &index : nullptr) && !lostPeer;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (ok) {
+            fs::path outp = outResolvedName(cfg, id), ip = outidx::indexPath(outp);
+            std::error_code ec;
+            fs::remove(ip, ec);   // before the output changes, as in the CLI's writeOutput
+            ok = writeFileAtomic(outp, text, err);
+            outidx::Stamp st;
+            if (ok && opt.index && !outidx::stampOf(outp, st)) { ok = false; err = "cannot stat " + outp.string(); }
+            if (ok && opt.index) ok = writeFileAtomic(ip, outidx::encode(index, st), err);
+        }
+        if (cancelled(cancel)) break;
+        report += "bank\t" + stem + "\t" + std::to_string(ms) + "\t" + (ok ? "1" : lostPeer ? "peer" : "0") + "\n";
+    }
+    report += "stats\t" + std::to_string(asked) + "\t" + (cancelled(cancel) ? "1" : "0") + "\n";
+    (void)writeAll(resFd, report.data(), report.size());
+
+    char c;
+    while (::read(stopFd, &c, 1) < 0 && errno == EINTR) {}   // EOF: every worker has resolved
+    server.join();
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    report = "served\t" + std::to_string(served.load()) + "\t" + std::to_string(ru.ru_maxrss) + "\nend\n";
+    (void)writeAll(resFd, report.data(), report.size());
+    ::close(resFd);
+}
+} // namespace detail
+
+// Resolves opt.banks across opt.workers processes. Returns false only if the
+// farm could not start; per-worker outcomes are in `rep`.
+inline bool run(const Config& cfg, const CancelToken* cancel, const Options& opt, Report& rep, string& err) {
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    rep = Report{};
+    if (opt.banks.empty()) { err = "no banks selected"; return false; }
+
+    // Cost per bank: measured ms, else file size scaled by the measured ms/byte.
+    auto known = loadCosts();
+    std::vector<double> cost(opt.banks.size());
+    std::vector<uintmax_t> size(opt.banks.size());
+    double msSum = 0, byteSum = 0;
+    for (size_t i = 0; i < opt.banks.size(); ++i) {
+        std::error_code ec;
+        size[i] = fs::file_size(opt.banks[i].second, ec);
+        if (auto it = known.find(opt.banks[i].second.stem().string()); it != known.end()) { msSum += it->second; byteSum += double(size[i]); }
+    }
+    double msPerByte = byteSum > 0 ? msSum / byteSum : 1e-3;
+    for (size_t i = 0; i < opt.banks.size(); ++i) {
+        auto it = known.find(opt.banks[i].second.stem().string());
+        cost[i] = it != known.end() ? it->second : double(size[i] + 1) * msPerByte;
+    }
+    auto parts = partition(cost, size_t(std::max(1, opt.workers)));
+    const size_t n = parts.size();
+    std::vector<detail::Range> ranges;
+    for (auto [b, e] : parts) ranges.push_back({opt.banks[b].first, opt.banks[e - 1].first});
+
+    // sock[a][b]: a's end [0] sends a's queries, b's server answers on end [1].
+    std::vector<std::vector<std::array<int, 2>>> sock(n, std::vector<std::array<int, 2>>(n, {-1, -1}));
+    std::vector<std::array<int, 2>> res(n, {-1, -1});
+    int stop[2] = {-1, -1};
+    auto closeAll = [&] {
+        for (auto& row : sock) for (auto& p : row) for (int& fd : p) if (fd >= 0) { ::close(fd); fd = -1; }
+        for (auto& p : res) for (int& fd : p) if (fd >= 0) { ::close(fd); fd = -1; }
+        for (int& fd : stop) if (fd >= 0) { ::close(fd); fd = -1; }
+    };
+    bool ok = ::pipe(stop) == 0;
+    for (size_t a = 0; ok && a < n; ++a) {
+        ok = ::pipe(res[a].data()) == 0;
+        for (size_t b = 0; ok && b < n; ++b)
+            if (a != b) ok = ::socketpair(AF_UNIX, SOCK_STREAM, 0, sock[a][b].data()) == 0;
+    }
+    if (!ok) { closeAll(); err = string("cannot create farm channels: ") + std::strerror(errno); return false; }
+
+    std::cout.flush();
+    std::vector<pid_t> pids;
+    for (size_t w = 0; w < n; ++w) {
+        pid_t pid = ::fork();
+        if (pid < 0) { err = "fork failed"; break; }
+        if (pid == 0) {
+            std::vector<int> queryFd(n, -1), serveFds;
+            for (size_t a = 0; a < n; ++a)
+                for (size_t b = 0; b < n; ++b) {
+                    if (a == b) continue;
+                    if (a == w) { queryFd[b] = sock[a][b][0]; ::close(sock[a][b][1]); }
+                    else if (b == w) { serveFds.push_back(sock[a][b][1]); ::close(sock[a][b][0]); }
+                    else { ::close(sock[a][b][0]); ::close(sock[a][b][1]); }
+                }
+            for (size_t a = 0; a < n; ++a) { ::close(res[a][0]); if (a != w) ::close(res[a][1]); }
+            ::close(stop[1]);
+            detail::work(cfg, cancel, opt, ranges, w, parts[w].first, parts[w].second, queryFd, serveFds, res[w][1], stop[0]);
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+    // The coordinator keeps only the report read ends and the stop write end.
+    for (auto& row : sock) for (auto& p : row) for (int& fd : p) if (fd >= 0) { ::close(fd); fd = -1; }
+    for (auto& p : res) { ::close(p[1]); p[1] = -1; }
+    ::close(stop[0]); stop[0] = -1;
+
+    rep.workers.resize(n);
+    for (size_t w = 0; w < n; ++w) {
+        auto& wr = rep.workers[w];
+        wr.first = ranges[w].lo; wr.last = ranges[w].hi;
+        wr.banks = parts[w].second - parts[w].first;
+        for (size_t i = parts[w].first; i < parts[w].second; ++i) wr.estMs += cost[i];
+    }
+    // Reports, in whatever order workers finish. Servers stay up until every
+    // worker is past its last bank (sent "stats" or died), then drain to EOF.
+    std::vector<string> buf(n);
+    std::vector<pollfd> pf;
+    for (size_t w = 0; w < pids.size(); ++w) pf.push_back({res[w][0], POLLIN, 0});
+    auto resolving = [&](size_t w) { return pf[w].fd >= 0 && buf[w].find("stats\t") == string::npos; };
+    for (size_t open = pf.size(); open > 0; ) {
+        bool busy = false;
+        for (size_t w = 0; w < pf.size(); ++w) busy = busy || resolving(w);
+        if (!busy && stop[1] >= 0) { ::close(stop[1]); stop[1] = -1; }   // release the servers
+        if (::poll(pf.data(), pf.size(), -1) < 0) { if (errno == EINTR) continue; break; }
+        for (size_t w = 0; w < pf.size(); ++w) {
+            if (pf[w].fd < 0 || !pf[w].revents) continue;
+            char tmp[4096];
+            ssize_t r = ::read(pf[w].fd, tmp, sizeof(tmp));
+            if (r < 0 && errno == EINTR) continue;
+            if (r > 0) { buf[w].append(tmp, size_t(r)); continue; }
+            pf[w].fd = -1;   // EOF (or error): the worker is gone
+            --open;
+        }
+    }
+    if (stop[1] >= 0) { ::close(stop[1]); stop[1] = -1; }
+    for (pid_t pid : pids) { int st = 0; while (::waitpid(pid, &st, 0) < 0 && errno == EINTR) {} }
+    closeAll();
+
+    for (size_t w = 0; w < pids.size(); ++w) {
+        auto& wr = rep.workers[w];
+        std::istringstream in(buf[w]);
+        for (string l; std::getline(in, l); ) {
+            std::vector<string> f;
+            for (size_t p = 0, q; p <= l.size(); p = q + 1) { q = l.find('\t', p); if (q == string::npos) q = l.size(); f.push_back(l.substr(p, q - p)); }
+            if (f[0] == "bank" && f.size() == 4) {
+                double ms = std::atof(f[2].c_str());
+                wr.busyMs += ms;
+                if (f[3] == "1") { ++wr.done; known[f[1]] = ms; }
+                else { ++wr.failed; wr.peerLost += f[3] == "peer"; }
+            } else if (f[0] == "stats" && f.size() == 3) {
+                wr.asked = std::strtoull(f[1].c_str(), nullptr, 10);
+                wr.cancelled = f[2] == "1";
+            } else if (f[0] == "served" && f.size() == 3) {
+                wr.served = std::strtoull(f[1].c_str(), nullptr, 10);
+                wr.rssKb = std::atol(f[2].c_str());
+            } else if (f[0] == "end") wr.finished = true;
+        }
+    }
+    string text, werr;
+    for (auto& [stem, ms] : known) text += stem + "\t" + std::to_string(ms) + "\n";
+    (void)writeFileAtomic(costsPath(), text, werr);
+    rep.wallSec = std::chrono::duration<double>(clock::now() - t0).count();
+    return pids.size() == n;
+}
+#else
+inline bool run(const Config&, const CancelToken*, const Options&, Report&, string& err) {
+    err = "the resolve farm needs fork() and is not available on this platform";
+    return false;
+}
+#endif
+
+} // namespace farm
+} // namespace scripted
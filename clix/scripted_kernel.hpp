@@ -2,6 +2,8 @@
 // C++23, header-only. Place beside scripted_core.hpp.
 #pragma once
 #include "scripted_core.hpp"
+#include "scripted_sched.hpp"
+#include "scripted_store.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -10,6 +12,26 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <tuple>
+
+#if defined(_WIN32)
+    #include <process.h>
+#else
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    extern char** environ;
+#endif
+#if defined(__linux__)
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
 
 namespace scripted {
 namespace kernel {
@@ -31,30 +53,24 @@ inline bool writeTextFile(const fs::path& p, const string& s) {
     out.write(s.data(), static_cast<std::streamsize>(s.size()));
     return static_cast<bool>(out);
 }
-inline std::string jsonEscape(const std::string& s) {
-    std::string o; o.reserve(s.size() + 8);
-    for (unsigned char c : s) {
-        switch (c) {
-            case '\\': o += "\\\\"; break;
-            case '\"': o += "\\\""; break;
-            case '\b': o += "\\b";  break;
-            case '\f': o += "\\f";  break;
-            case '\n': o += "\\n";  break;
-            case '\r': o += "\\r";  break;
-            case '\t': o += "\\t";  break;
-            default:
-                if (c < 0x20) { char buf[7]; std::snprintf(buf, sizeof(buf), "\\u%04X", c); o += buf; }
-                else o += static_cast<char>(c);
-        }
-    }
-    return o;
+inline long processId() {
+#if defined(_WIN32)
+    return static_cast<long>(_getpid());
+#else
+    return static_cast<long>(getpid());
+#endif
 }
+// JSON escaping lives in the core so every writer shares the vectorised path.
+using ::scripted::jsonEscape;
 
 // ---------- manifest ----------
 struct PluginManifest {
     string   name;
     string   entry_win; // e.g., "run.bat"
     string   entry_lin; // e.g., "run.sh"
+    string   io;        // "files" (default) or "memfd" (Linux: payloads in sealed memfds)
+    bool     batch = false;   // accepts many cells per process ("batch": true)
+    size_t   batchBytes = 0;  // per-process input budget ("batch_bytes"; 0 = default)
     fs::path dir;
 };
 
@@ -67,12 +83,63 @@ inline string jsonGetStr(const string& j, const string& key) {
     return j.substr(p + 1, q - (p + 1));
 }
 
+// Unquoted scalar after "key": (number, true/false); empty if absent.
+inline string jsonGetRaw(const string& j, const string& key) {
+    auto p = j.find("\"" + key + "\"");
+    if (p == string::npos) return {};
+    p = j.find(':', p);           if (p == string::npos) return {};
+    auto q = j.find_first_of(",}\n", p + 1);
+    return trim(j.substr(p + 1, q == string::npos ? string::npos : q - (p + 1)));
+}
+
+// End of the JSON value starting at j[p] (strings, nesting and escapes aware).
+inline size_t jsonSkipValue(const string& j, size_t p) {
+    int depth = 0;
+    for (; p < j.size(); ++p) {
+        char c = j[p];
+        if (c == '"') {
+            for (++p; p < j.size() && j[p] != '"'; ++p) if (j[p] == '\\') ++p;
+            if (depth == 0) return p + 1;
+        }
+        else if (c == '[' || c == '{') ++depth;
+        else if (c == ']' || c == '}') { if (depth == 0) return p; if (--depth == 0) return p + 1; }
+        else if (depth == 0 && (c == ',' || std::isspace(static_cast<unsigned char>(c)))) return p;
+    }
+    return p;
+}
+
+// Splits the top-level array of `j` (or the array under `key`) into its
+// elements' raw JSON text.
+inline bool jsonSplitArray(const string& j, std::vector<string>& items, const string& key = "results") {
+    items.clear();
+    size_t p = j.find_first_not_of(" \t\r\n");
+    if (p == string::npos) return false;
+    if (j[p] != '[') {
+        p = j.find("\"" + key + "\"");
+        if (p == string::npos || (p = j.find(':', p)) == string::npos) return false;
+        p = j.find_first_not_of(" \t\r\n", p + 1);
+        if (p == string::npos || j[p] != '[') return false;
+    }
+    ++p;
+    while (true) {
+        p = j.find_first_not_of(" \t\r\n,", p);
+        if (p == string::npos) return false;
+        if (j[p] == ']') return true;
+        size_t e = jsonSkipValue(j, p);
+        items.push_back(j.substr(p, e - p));
+        p = e;
+    }
+}
+
 inline PluginManifest loadManifest(const fs::path& dir) {
     PluginManifest m; m.dir = dir;
     string j; (void)readTextFile(dir / "plugin.json", j);
     m.name      = jsonGetStr(j, "name");
     m.entry_win = jsonGetStr(j, "entry_win");
     m.entry_lin = jsonGetStr(j, "entry_lin");
+    m.io        = jsonGetStr(j, "io");
+    m.batch     = jsonGetRaw(j, "batch") == "true";
+    try { m.batchBytes = std::stoull(jsonGetRaw(j, "batch_bytes")); } catch (...) {}
     return m;
 }
 
@@ -90,12 +157,166 @@ inline std::vector<PluginManifest> discoverPlugins(const fs::path& root = fs::pa
     return out;
 }
 
+// ---------- memfd transport (Linux) ----------
+#if defined(__linux__)
+// Anonymous in-memory file holding `data`, sealed against any further change so
+// the plugin can mmap it without the kernel copying or the payload moving under it.
+inline int sealedMemfd(const char* name, const string& data, string& err) {
+    int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) { err = string("memfd_create failed: ") + std::strerror(errno); return -1; }
+    if (!data.empty()) {
+        if (ftruncate(fd, static_cast<off_t>(data.size())) != 0) { err = "ftruncate failed"; close(fd); return -1; }
+        void* p = mmap(nullptr, data.size(), PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) { err = "mmap failed"; close(fd); return -1; }
+        std::memcpy(p, data.data(), data.size());
+        munmap(p, data.size());
+    }
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        err = "sealing memfd failed"; close(fd); return -1;
+    }
+    return fd;
+}
+inline string fdPath(int fd) { return "/proc/self/fd/" + std::to_string(fd); }
+
+#endif
+
+// ---------- process spawning & CPU placement ----------
+// Allowed CPUs ordered by (package, core, cpu) so that neighbouring entries share
+// a socket and SMT siblings sit together; slot CPU sets are cut from this order.
+inline std::vector<int> orderedCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set; CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) cpus.push_back(c);
+    auto topo = [](int cpu, const char* what) {
+        std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + what);
+        int v = 0; f >> v; return v;
+    };
+    std::vector<std::tuple<int, int, int>> keyed;
+    for (int c : cpus) keyed.emplace_back(topo(c, "physical_package_id"), topo(c, "core_id"), c);
+    std::sort(keyed.begin(), keyed.end());
+    cpus.clear();
+    for (auto& [pkg, core, c] : keyed) cpus.push_back(c);
+#endif
+    if (cpus.empty())
+        for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c) cpus.push_back(int(c));
+    return cpus;
+}
+
+inline string cpuListString(const std::vector<int>& cpus) {
+    string s;
+    for (size_t i = 0; i < cpus.size(); ) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!s.empty()) s += ",";
+        s += std::to_string(cpus[i]);
+        if (j > i) s += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return s;
+}
+
+// Pins the calling thread (and threads/children it creates later); no-op off Linux.
+inline bool pinThisThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return false;
+    cpu_set_t set; CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus; return false;
+#endif
+}
+
+struct SpawnResult {
+    int    exit = -1;    // exit status, or 128+signal
+    double cpuSec = 0;   // child user+sys time
+};
+
+#if !defined(_WIN32)
+// Runs `entry <in> <outdir>` through /bin/sh (so scripts without a shebang still
+// run, as with std::system) with stdout/stderr in log/err, `keep` fds inherited,
+// extra `env`, and (Linux) the child pinned to `cpus` when given. Everything the
+// child needs is built before fork(), so it is safe from threaded callers.
+// With `cancel`, the child is polled instead of waited on; once the token fires
+// it gets SIGTERM, then SIGKILL after kKillGraceMs.
+inline constexpr int kKillGraceMs = 2000;
+inline SpawnResult spawnEntry(const fs::path& entry, const string& in, const fs::path& outdir,
+                              const fs::path& log, const fs::path& errf, const std::vector<int>& keep,
+                              const std::vector<std::pair<string, string>>& env,
+                              const std::vector<int>* cpus = nullptr, const CancelToken* cancel = nullptr) {
+    std::vector<string> envStore;
+    for (char** e = environ; e && *e; ++e) envStore.emplace_back(*e);
+    for (auto& [k, v] : env) envStore.push_back(k + "=" + v);
+    std::vector<char*> envp;
+    for (auto& e : envStore) envp.push_back(e.data());
+    envp.push_back(nullptr);
+    string script = "exec \"$0\" \"$@\"", entryS = entry.string(), outS = outdir.string();
+    char* argv[] = {const_cast<char*>("sh"), const_cast<char*>("-c"), script.data(), entryS.data(),
+                    const_cast<char*>(in.c_str()), outS.data(), nullptr};
+#if defined(__linux__)
+    cpu_set_t set; CPU_ZERO(&set);
+    if (cpus) for (int c : *cpus) CPU_SET(c, &set);
+#endif
+    SpawnResult r;
+    pid_t pid = fork();
+    if (pid < 0) return r;
+    if (pid == 0) {
+#if defined(__linux__)
+        if (cpus && !cpus->empty()) sched_setaffinity(0, sizeof(set), &set);
+#endif
+        for (int fd : keep) fcntl(fd, F_SETFD, 0);
+        int lo = open(log.c_str(),  O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int le = open(errf.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (lo >= 0) { dup2(lo, 1); close(lo); }
+        if (le >= 0) { dup2(le, 2); close(le); }
+        execve("/bin/sh", argv, envp.data());
+        _exit(127);
+    }
+    int st = 0;
+    rusage ru{};
+    if (!cancel) {
+        while (wait4(pid, &st, 0, &ru) < 0 && errno == EINTR) {}
+    } else {
+        using clock = std::chrono::steady_clock;
+        auto nap = std::chrono::microseconds(200);
+        clock::time_point termAt{};
+        bool termed = false, killed = false;
+        for (;;) {
+            pid_t w = wait4(pid, &st, WNOHANG, &ru);
+            if (w == pid || (w < 0 && errno != EINTR)) break;
+            if (!termed && cancel->expired()) { kill(pid, SIGTERM); termed = true; termAt = clock::now(); }
+            else if (termed && !killed && clock::now() - termAt > std::chrono::milliseconds(kKillGraceMs)) {
+                kill(pid, SIGKILL); killed = true;
+            }
+            std::this_thread::sleep_for(nap);
+            nap = std::min(nap * 2, std::chrono::microseconds(20000));
+        }
+    }
+    r.exit = WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+    r.cpuSec = double(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) + double(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    return r;
+}
+#endif
+
 // ---------- Kernel ----------
 struct Kernel {
     const Config& cfg;
     Workspace&    ws;
     Paths         paths;
     std::vector<PluginManifest> plugins;
+    bool          interactive = true; // scheduler class for jobs started from here
+    const CancelToken* cancel = nullptr; // stops range runs between cells and terminates running plugins
+
+    // What one plugin process produced for one cell; shared with coalesced callers.
+    struct RunOutcome {
+        bool   ok = false;
+        string out_json;
+        string report;
+    };
+    SingleFlight<string, RunOutcome> runs; // (plugin, cell, input hash) -> in-flight run
+    store::ArtifactStore artifacts{fs::path("files/out/artifacts")}; // used when cfg.artifactStore
 
     Kernel(const Config& c, Workspace& w) : cfg(c), ws(w) { plugins = discoverPlugins(); }
     void refresh() { plugins = discoverPlugins(); }
@@ -109,6 +330,17 @@ struct Kernel {
         return nullptr;
     }
 
+    // Builds input.json once the payload locations are known: "code_file" (empty
+    // for batch inputs, which embed code) and, for memfd I/O, "output_file".
+    using InputBuilder = std::function<string(const string& codeFile, const string& outputFile)>;
+
+    // Placement for one plugin process: CPUs to pin the child to (none = inherit),
+    // and the child's CPU time, accumulated once it has exited.
+    struct JobCtx {
+        const std::vector<int>* cpus = nullptr;
+        double cpuSec = 0;
+    };
+
     // Runs plugin by name against bank/reg/addr.
     // stdin_json_or_path: either a path to a .json file or an inline JSON string (e.g., "{}").
     // Produces: files/out/plugins/<bank>/r<reg>a<addr>/<plugin>/{code.txt,input.json,output.json,run.log,run.err,run.cmd}
@@ -131,21 +363,364 @@ struct Kernel {
         }
         std::unordered_set<string> visited;
         string code = R.resolve(raw, bank, visited);
+        if (cancelled(cancel)) { out_report = "Cancelled: " + cancel->reason(); return false; }
+        string title;
+        {
+            std::lock_guard lk(ws.mu);
+            if (auto it = ws.banks.find(bank); it != ws.banks.end()) title = it->second.title;
+        }
+        return runCell(*P, bank, reg, addr, code, readStdinArg(stdin_json_or_path), title,
+                       out_json, out_report, nullptr);
+    }
+
+    // Result of one cell in a range run.
+    struct CellRun {
+        long long addr = 0;
+        bool      ok = false;
+        string    out_json;
+        string    report;
+    };
+
+    // Per-slot accounting for a parallel range run.
+    struct SlotStats {
+        std::vector<int> cpus;    // empty: not pinned
+        size_t jobs = 0;          // plugin processes run by this slot
+        double busySec = 0;       // wall time spent inside jobs
+        double cpuSec = 0;        // children's user+sys time
+    };
+    struct RangeStats {
+        std::vector<int>       cliCpus;  // where the CLI thread ran meanwhile
+        std::vector<SlotStats> slots;
+        double                 wallSec = 0;
+    };
+
+    // Runs a plugin over every cell of `reg` with from <= addr <= to. Plugins whose
+    // manifest has "batch": true get the cells in batches (one process per batch,
+    // sized by "batch_bytes"); others run once per cell. With jobs > 1, that many
+    // slots run processes concurrently, each pinned to its own contiguous CPU set
+    // after the first cfg.cliCores CPUs, which stay with the CLI. Returns the number
+    // of plugin processes started; once `cancel` fires, spans not yet started are
+    // skipped and their cells report "cancelled".
+    size_t runRange(const string& name, long long bank, long long reg, long long from, long long to,
+                    const string& stdin_json_or_path, std::vector<CellRun>& results, string& out_report,
+                    int jobs = 1, RangeStats* stats = nullptr)
+    {
+        results.clear();
+        auto P = find(name);
+        if (!P) { out_report = "Plugin not found: " + name; return 0; }
+        string err;
+        if (!ensureBankLoadedInWorkspace(cfg, ws, bank, err) && !ws.banks.count(bank)) { out_report = err; return 0; }
+        const Bank& B = ws.banks[bank];
+        if (!B.hasReg(reg)) { out_report = "No register " + std::to_string(reg); return 0; }
+        std::vector<long long> addrs = B.addrsInRange(reg, from, to);
+        if (addrs.empty()) { out_report = "No cells in range"; return 0; }
+
+        // Range runs queue as batch work behind other sessions' interactive jobs.
+        struct ClassGuard { bool& f; bool old; ~ClassGuard() { f = old; } } guard{interactive, interactive};
+        interactive = false;
+
+        // Everything touching the workspace happens here, before any worker starts.
+        Resolver R(cfg, ws);
+        std::vector<string> codes;
+        codes.reserve(addrs.size());
+        string raw;
+        for (long long a : addrs) {
+            if (cancelled(cancel)) { out_report = "Cancelled: " + cancel->reason(); return 0; }
+            std::unordered_set<string> visited;
+            B.get(reg, a, raw);
+            codes.push_back(R.resolve(raw, bank, visited));
+        }
+        string stdin_json = readStdinArg(stdin_json_or_path);
+        const string title = ws.banks[bank].title;
+
+        // One span per plugin process: single cells, or batches cut by byte budget.
+        std::vector<std::pair<size_t, size_t>> spans;
+        size_t budget = P->batchBytes ? P->batchBytes : kDefaultBatchBytes;
+        for (size_t i = 0; i < addrs.size(); ) {
+            size_t j = i + 1;
+            if (P->batch) {
+                size_t bytes = codes[i].size() + stdin_json.size() + 96;
+                while (j < addrs.size() && bytes + codes[j].size() + stdin_json.size() + 96 <= budget)
+                    bytes += codes[j++].size() + stdin_json.size() + 96;
+            }
+            spans.emplace_back(i, j);
+            i = j;
+        }
+
+        results.resize(addrs.size());
+        for (size_t k = 0; k < addrs.size(); ++k) results[k].addr = addrs[k];
+        std::atomic<size_t> started{0};
+        auto runSpan = [&](size_t s, JobCtx* job) {
+            auto [i, j] = spans[s];
+            if (cancelled(cancel)) {
+                for (size_t k = i; k < j; ++k) results[k].report = "cancelled";
+                return;
+            }
+            ++started;
+            if (P->batch) runBatch(*P, bank, reg, addrs, codes, i, j, stdin_json, title, results, job);
+            else results[i].ok = runCell(*P, bank, reg, addrs[i], codes[i], stdin_json, title,
+                                         results[i].out_json, results[i].report, job);
+        };
+
+        using clock = std::chrono::steady_clock;
+        auto t0 = clock::now();
+        RangeStats local;
+        RangeStats& st = stats ? *stats : local;
+        st = RangeStats{};
+        size_t nslots = std::min(spans.size(), static_cast<size_t>(std::max(1, jobs)));
+        st.slots.resize(nslots);
+
+        if (jobs <= 1) {
+            for (size_t s = 0; s < spans.size(); ++s) {
+                JobCtx job;
+                auto j0 = clock::now();
+                runSpan(s, &job);
+                st.slots[0].busySec += std::chrono::duration<double>(clock::now() - j0).count();
+                st.slots[0].cpuSec  += job.cpuSec;
+                ++st.slots[0].jobs;
+            }
+        } else {
+            std::vector<int> allowed = orderedCpus();
+            planSlots(allowed, st.cliCpus, st.slots);
+            bool pinned = pinThisThread(st.cliCpus); // workers inherit this; their children get slot CPUs
+            std::atomic<size_t> next{0};
+            std::vector<std::thread> workers;
+            for (size_t w = 0; w < nslots; ++w)
+                workers.emplace_back([&, w] {
+                    SlotStats& slot = st.slots[w];
+                    for (size_t s; (s = next.fetch_add(1)) < spans.size(); ) {
+                        JobCtx job; job.cpus = &slot.cpus;
+                        auto j0 = clock::now();
+                        runSpan(s, &job);
+                        slot.busySec += std::chrono::duration<double>(clock::now() - j0).count();
+                        slot.cpuSec  += job.cpuSec;
+                        ++slot.jobs;
+                    }
+                });
+            for (auto& t : workers) t.join();
+            if (pinned) pinThisThread(allowed);
+        }
+        st.wallSec = std::chrono::duration<double>(clock::now() - t0).count();
+        if (cancelled(cancel)) out_report = "Cancelled: " + cancel->reason();
+        return started.load();
+    }
+
+    // The stored output for one cell: the record's output, or for a batch record
+    // the array entry whose input cell has this address.
+    static string cellOutput(const store::Artifact& a, const string& addrStr) {
+        if (a.first == a.last) return a.field[store::Output];
+        std::vector<string> cells, outs;
+        if (!jsonSplitArray(a.field[store::Input], cells, "cells") || !jsonSplitArray(a.field[store::Output], outs))
+            return a.field[store::Output];
+        for (size_t k = 0; k < cells.size() && k < outs.size(); ++k)
+            if (jsonGetRaw(cells[k], "addr") == "\"" + jsonEscape(addrStr) + "\"") return outs[k];
+        return {};
+    }
+
+    // Writes the newest stored run of every cell/batch back out as the per-run
+    // directory layout (code.txt, input.json, output.json, run.log, run.err).
+    size_t exportArtifacts(const fs::path& root, string& err) {
+        size_t n = 0;
+        for (auto& r : artifacts.newest()) {
+            store::Artifact a;
+            if (!artifacts.read(r, a, err)) return n;
+            string addrs = toBaseN(a.first, cfg.base, cfg.widthAddr);
+            if (a.last != a.first) addrs += "-" + toBaseN(a.last, cfg.base, cfg.widthAddr);
+            fs::path dir = root / (string(1, cfg.prefix) + toBaseN(a.bank, cfg.base, cfg.widthBank)) /
+                           ("r" + toBaseN(a.reg, cfg.base, cfg.widthReg) + "a" + addrs) / a.plugin;
+            bool ok = (a.first != a.last || writeTextFile(dir / "code.txt", a.field[store::Code])) &&
+                      writeTextFile(dir / "input.json", a.field[store::Input]) &&
+                      (a.field[store::Output].empty() || writeTextFile(dir / "output.json", a.field[store::Output])) &&
+                      writeTextFile(dir / "run.log", a.field[store::Log]) &&
+                      writeTextFile(dir / "run.err", a.field[store::Err]);
+            if (!ok) { err = "cannot write under " + dir.string(); return n; }
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    static constexpr size_t kDefaultBatchBytes = 4u << 20;
+
+    // Where a run's files go: its own directory under files/out/plugins, or with
+    // the artifact store on, a per-thread scratch directory emptied after each run.
+    fs::path runDir(const fs::path& tail) const {
+        if (!cfg.artifactStore) return fs::path("files/out/plugins") / tail;
+        static std::atomic<unsigned> nextScratch{0};
+        thread_local unsigned mine = nextScratch++;
+        return artifacts.dir() / "scratch" / (std::to_string(processId()) + "-" + std::to_string(mine));
+    }
+
+    static void capture(store::Artifact& a, const string* code, const string& input, const string& output,
+                        const string& log, const string& err, int exit) {
+        if (code) a.field[store::Code] = *code;
+        a.field[store::Input]  = input;
+        a.field[store::Output] = output;
+        a.field[store::Log]    = log;
+        a.field[store::Err]    = err;
+        a.exit = exit;
+    }
 
+    // Appends a captured run to the store and clears the scratch files.
+    void keepArtifact(store::Artifact& a, const fs::path& scratch, string& report) {
+        std::error_code ec;
+        for (const char* f : {"code.txt", "input.json", "output.json", "run.log", "run.err"})
+            fs::remove(scratch / f, ec);
+        fs::remove(scratch, ec);
+        if (a.field[store::Input].empty()) return; // nothing ran
+        string err;
+        if (!artifacts.append(a, err)) { report += "artifact store: " + err + "\n"; return; }
+        auto nl = report.find('\n');
+        report.insert(nl == string::npos ? report.size() : nl, " run=" + std::to_string(a.run));
+    }
+
+    // Splits the allowed CPUs (topology order) into the CLI's share and one
+    // contiguous set per slot. With fewer CPUs than slots, slots share round-robin.
+    void planSlots(const std::vector<int>& allowed, std::vector<int>& cli, std::vector<SlotStats>& slots) const {
+        size_t ncli = std::min(static_cast<size_t>(std::max(0, cfg.cliCores)), allowed.size() - 1);
+        cli.assign(allowed.begin(), allowed.begin() + static_cast<std::ptrdiff_t>(ncli));
+        std::vector<int> rest(allowed.begin() + static_cast<std::ptrdiff_t>(ncli), allowed.end());
+        if (cli.empty()) cli = allowed;
+        size_t n = slots.size();
+        for (size_t k = 0; k < n; ++k) {
+            if (rest.size() >= n)
+                slots[k].cpus.assign(rest.begin() + static_cast<std::ptrdiff_t>(k * rest.size() / n),
+                                     rest.begin() + static_cast<std::ptrdiff_t>((k + 1) * rest.size() / n));
+            else
+                slots[k].cpus = {rest[k % rest.size()]};
+        }
+    }
+
+    // One plugin process for one cell whose code is already resolved. Concurrent
+    // runs of the same plugin on the same cell with the same code and stdin
+    // share one process; waiters get its output and report.
+    bool runCell(const PluginManifest& P, long long bank, long long reg, long long addr, const string& code,
+                 const string& stdin_json, const string& title, string& out_json, string& out_report, JobCtx* job)
+    {
+        // The full code and stdin, length-prefixed: a hash collision must never hand
+        // one cell's output to another.
+        string key = P.name + '\n' + std::to_string(bank) + '.' + std::to_string(reg) + '.' + std::to_string(addr) +
+                     '\n' + std::to_string(code.size()) + '\n' + code + stdin_json;
+        RunOutcome r = runs.run(key, [&] {
+            RunOutcome o;
+            o.ok = runCellOnce(P, bank, reg, addr, code, stdin_json, title, o.out_json, o.report, job);
+            return o;
+        });
+        out_json = std::move(r.out_json);
+        out_report = std::move(r.report);
+        return r.ok;
+    }
+
+    bool runCellOnce(const PluginManifest& P, long long bank, long long reg, long long addr, const string& code,
+                     const string& stdin_json, const string& title, string& out_json, string& out_report, JobCtx* job)
+    {
         // Layout
         string bankStr = string(1, cfg.prefix) + toBaseN(bank, cfg.base, cfg.widthBank);
         string regStr  = toBaseN(reg,  cfg.base, cfg.widthReg);
         string addrStr = toBaseN(addr, cfg.base, cfg.widthAddr);
 
-        fs::path outdir = fs::path("files/out/plugins") / bankStr / ("r" + regStr + "a" + addrStr) / name;
+        fs::path outdir = runDir(fs::path(bankStr) / ("r" + regStr + "a" + addrStr) / P.name);
         fs::create_directories(outdir);
 
+        // input.json (JSON-escaped strings; stdin is inserted as-is)
+        auto makeInput = [&](const string& codeFile, const string& outputFile) {
+            std::ostringstream is;
+            is << "{\n";
+            is << "  \"bank\": \""      << jsonEscape(bankStr)  << "\",\n";
+            is << "  \"reg\": \""       << jsonEscape(regStr)   << "\",\n";
+            is << "  \"addr\": \""      << jsonEscape(addrStr)  << "\",\n";
+            is << "  \"title\": \""     << jsonEscape(title)    << "\",\n";
+            is << "  \"code_file\": \"" << jsonEscape(codeFile) << "\",\n";
+            if (!outputFile.empty()) {
+                is << "  \"code_bytes\": "     << code.size() << ",\n";
+                is << "  \"output_file\": \"" << jsonEscape(outputFile) << "\",\n";
+            }
+            is << "  \"stdin\": "       << stdin_json << "\n";
+            is << "}\n";
+            return is.str();
+        };
+        if (!cfg.artifactStore) return invoke(P, fs::absolute(outdir), &code, makeInput, out_json, out_report, job);
+        store::Artifact art{0, bank, reg, addr, addr, P.name};
+        bool ok = invoke(P, fs::absolute(outdir), &code, makeInput, out_json, out_report, job, &art);
+        keepArtifact(art, outdir, out_report);
+        return ok;
+    }
+
+    static string readStdinArg(const string& stdin_json_or_path) {
+        string stdin_json = "{}";
+        if (!stdin_json_or_path.empty()) {
+            if (fs::exists(stdin_json_or_path)) (void)readTextFile(stdin_json_or_path, stdin_json);
+            else stdin_json = stdin_json_or_path;
+        }
+        return stdin_json.empty() ? string("{}") : stdin_json;
+    }
+
+    // One batch process over cells [i, j). input.json carries
+    //   { "batch": true, "title", "cells": [ {bank, reg, addr, code, stdin}, ... ] }
+    // and the plugin answers with an array of per-cell outputs in the same order,
+    // either bare or as { "results": [...] }.
+    void runBatch(const PluginManifest& P, long long bank, long long reg, const std::vector<long long>& addrs,
+                  const std::vector<string>& codes, size_t i, size_t j, const string& stdin_json,
+                  const string& title, std::vector<CellRun>& results, JobCtx* job)
+    {
+        string bankStr = string(1, cfg.prefix) + toBaseN(bank, cfg.base, cfg.widthBank);
+        string regStr  = toBaseN(reg, cfg.base, cfg.widthReg);
+        fs::path outdir = runDir(fs::path(bankStr) /
+            ("r" + regStr + "a" + toBaseN(addrs[i], cfg.base, cfg.widthAddr) + "-" +
+             toBaseN(addrs[j - 1], cfg.base, cfg.widthAddr)) / P.name);
+        fs::create_directories(outdir);
+
+        auto makeInput = [&](const string&, const string& outputFile) {
+            string in;
+            size_t est = 128;
+            for (size_t k = i; k < j; ++k) est += codes[k].size() + stdin_json.size() + 96;
+            in.reserve(est);
+            in += "{\n  \"batch\": true,\n  \"title\": \"";
+            jsonEscapeAppend(in, title);
+            in += "\",\n";
+            if (!outputFile.empty()) in += "  \"output_file\": \"" + jsonEscape(outputFile) + "\",\n";
+            in += "  \"cells\": [\n";
+            for (size_t k = i; k < j; ++k) {
+                in += "    {\"bank\": \""; jsonEscapeAppend(in, bankStr);
+                in += "\", \"reg\": \"";   jsonEscapeAppend(in, regStr);
+                in += "\", \"addr\": \"";  jsonEscapeAppend(in, toBaseN(addrs[k], cfg.base, cfg.widthAddr));
+                in += "\", \"code\": \"";  jsonEscapeAppend(in, codes[k]);
+                in += "\", \"stdin\": ";   in += stdin_json;
+                in += (k + 1 < j) ? "},\n" : "}\n";
+            }
+            in += "  ]\n}\n";
+            return in;
+        };
+        string out_json, report;
+        store::Artifact art{0, bank, reg, addrs[i], addrs[j - 1], P.name};
+        bool ok = invoke(P, fs::absolute(outdir), nullptr, makeInput, out_json, report, job,
+                         cfg.artifactStore ? &art : nullptr);
+        if (cfg.artifactStore) keepArtifact(art, outdir, report);
+        std::vector<string> items;
+        if (ok && !jsonSplitArray(out_json, items)) { ok = false; report = "batch output is not an array\n" + report; }
+        if (ok && items.size() != j - i) {
+            ok = false;
+            report = "batch output has " + std::to_string(items.size()) + " entries for " +
+                     std::to_string(j - i) + " cells\n" + report;
+        }
+        for (size_t k = i; k < j; ++k) {
+            CellRun& c = results[k];
+            c.ok = ok; c.report = report;
+            if (ok) c.out_json = std::move(items[k - i]);
+        }
+    }
+
+    // Runs the manifest's entry over one input using its transport (files or memfd).
+    // `code` is staged as code.txt / a code memfd when non-null.
+    bool invoke(const PluginManifest& P, const fs::path& absOutdir, const string* code,
+                const InputBuilder& makeInput, string& out_json, string& out_report, JobCtx* job = nullptr,
+                store::Artifact* art = nullptr)
+    {
         // Select entry and normalize paths
-        const std::string entry = scripted::kWindows ? P->entry_win : P->entry_lin;
+        const std::string entry = scripted::kWindows ? P.entry_win : P.entry_lin;
         if (entry.empty()) { out_report = "Plugin entry not set in manifest."; return false; }
 
-        fs::path absOutdir  = fs::absolute(outdir);
-        fs::path entryPath  = fs::absolute(P->dir / fs::path(entry));
+        fs::path entryPath  = fs::absolute(P.dir / fs::path(entry));
         fs::path codeFile   = absOutdir / "code.txt";
         fs::path inputFile  = absOutdir / "input.json";
         fs::path outputFile = absOutdir / "output.json";
@@ -157,28 +732,25 @@ struct Kernel {
             return false;
         }
 
-        if (!writeTextFile(codeFile, code)) {
-            out_report = "Cannot write " + codeFile.string();
-            return false;
-        }
+        // Host-wide slot (no-op when no scheduler is running); held until the child exits.
+        sched::Ticket ticket = sched::acquire(interactive);
+        string schedNote = ticket.scheduled ? " sched_wait_ms=" + std::to_string(ticket.waitedUs / 1000)
+                         : ticket.timedOut ? " sched=timeout" : "";
 
-        string stdin_json = "{}";
-        if (!stdin_json_or_path.empty()) {
-            if (fs::exists(stdin_json_or_path)) (void)readTextFile(stdin_json_or_path, stdin_json);
-            else stdin_json = stdin_json_or_path;
+#if defined(__linux__)
+        if (P.io == "memfd") {
+            bool ok = runMemfd(entryPath, absOutdir, code, makeInput, out_json, out_report, job, art);
+            if (ok && !schedNote.empty()) out_report.insert(out_report.find('\n'), schedNote);
+            return ok;
         }
+#endif
 
-        // Write input.json (JSON-escaped strings; stdin is inserted as-is)
-        std::ostringstream is;
-        is << "{\n";
-        is << "  \"bank\": \""      << jsonEscape(bankStr)              << "\",\n";
-        is << "  \"reg\": \""       << jsonEscape(regStr)               << "\",\n";
-        is << "  \"addr\": \""      << jsonEscape(addrStr)              << "\",\n";
-        is << "  \"title\": \""     << jsonEscape(ws.banks[bank].title) << "\",\n";
-        is << "  \"code_file\": \"" << jsonEscape(codeFile.string())    << "\",\n";
-        is << "  \"stdin\": "       << (stdin_json.empty() ? "{}" : stdin_json) << "\n";
-        is << "}\n";
-        if (!writeTextFile(inputFile, is.str())) {
+        if (code && !writeTextFile(codeFile, *code)) {
+            out_report = "Cannot write " + codeFile.string();
+            return false;
+        }
+        const string input = makeInput(code ? codeFile.string() : string(), string());
+        if (!writeTextFile(inputFile, input)) {
             out_report = "Cannot write " + inputFile.string();
             return false;
         }
@@ -206,39 +778,97 @@ struct Kernel {
             // Execute
             //int ec = std::system(cmd.c_str());
             ec = std::system(cmd.c_str());
+            (void)job; // no affinity/CPU accounting here
         #else
-            // --- POSIX branch unchanged (already fine) ---
-            auto sq = [](const std::string& s){ return "'" + s + "'"; };
-            const std::string inner =
-                "\"" + entryPath.string() + "\" " +
-                "\"" + inputFile.string() + "\" " +
-                "\"" + absOutdir.string() + "\" > " +
-                "\"" + logFile.string()   + "\" 2> " +
-                "\"" + errFile.string()   + "\"";
-            const std::string cmd = std::string("/bin/sh -c ") + sq(inner);
-            ec = std::system(cmd.c_str());
+            // --- POSIX: fork/exec so the child can be pinned and its CPU time read back ---
+            SpawnResult sr = spawnEntry(entryPath, inputFile.string(), absOutdir, logFile, errFile, {}, {},
+                                        job ? job->cpus : nullptr, cancel);
+            ec = sr.exit;
+            if (job) job->cpuSec += sr.cpuSec;
         #endif
 
         // Read plugin output/report
         std::string outContent;
-        if (!readTextFile(outputFile, outContent)) {
-            std::string errtxt; (void)readTextFile(errFile, errtxt);
+        bool got = readTextFile(outputFile, outContent);
+        std::string logtxt; (void)readTextFile(logFile, logtxt);
+        std::string errtxt; (void)readTextFile(errFile, errtxt);
+        if (art) capture(*art, code, input, outContent, logtxt, errtxt, ec);
+        if (!got) {
             out_report = "Plugin did not produce output.json. Exit=" + std::to_string(ec) +
                         (errtxt.empty() ? "" : ("\nerr:\n" + errtxt));
             return false;
         }
         out_json = std::move(outContent);
 
+        std::ostringstream rep;
+        rep << "exit=" << ec << schedNote << "\n";
+        if (!logtxt.empty()) rep << "log:\n" << logtxt << "\n";
+        if (!errtxt.empty()) rep << "stderr:\n" << errtxt << "\n";
+        out_report = rep.str();
+        return true;
+
+    }
+
+#if defined(__linux__)
+    // io = "memfd": code and input.json go into sealed memfds passed to the child
+    // (argv[1] and "code_file" are /proc/self/fd/N paths, so file-reading plugins
+    // work unchanged); the plugin writes its result to SCRIPTED_OUTPUT_FD, which
+    // the kernel maps after exit. Only run.log/run.err touch the disk.
+    bool runMemfd(const fs::path& entryPath, const fs::path& absOutdir, const string* code,
+                  const InputBuilder& makeInput, string& out_json, string& out_report, JobCtx* job,
+                  store::Artifact* art)
+    {
+        string err;
+        int codeFd = -1;
+        if (code && (codeFd = sealedMemfd("scripted-code", *code, err)) < 0) { out_report = err; return false; }
+        int outFd = memfd_create("scripted-output", MFD_CLOEXEC);
+        if (outFd < 0) { if (codeFd >= 0) close(codeFd); out_report = "memfd_create failed"; return false; }
+
+        const string input = makeInput(codeFd >= 0 ? fdPath(codeFd) : string(), fdPath(outFd));
+        int inFd = sealedMemfd("scripted-input", input, err);
+        if (inFd < 0) { if (codeFd >= 0) close(codeFd); close(outFd); out_report = err; return false; }
+
+        fs::path logFile = absOutdir / "run.log", errFile = absOutdir / "run.err";
+        std::vector<int> keep{inFd, outFd};
+        std::vector<std::pair<string, string>> env{
+            {"SCRIPTED_IO", "memfd"},
+            {"SCRIPTED_INPUT_FD", std::to_string(inFd)},
+            {"SCRIPTED_OUTPUT_FD", std::to_string(outFd)}};
+        if (codeFd >= 0) { keep.push_back(codeFd); env.push_back({"SCRIPTED_CODE_FD", std::to_string(codeFd)}); }
+        SpawnResult sr = spawnEntry(entryPath, fdPath(inFd), absOutdir, logFile, errFile, keep, env,
+                                    job ? job->cpus : nullptr, cancel);
+        int ec = sr.exit;
+        if (job) job->cpuSec += sr.cpuSec;
+        if (codeFd >= 0) close(codeFd);
+        close(inFd);
+
+        struct stat st{};
+        bool got = fstat(outFd, &st) == 0 && st.st_size > 0;
+        if (got) {
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, outFd, 0);
+            if (p == MAP_FAILED) got = false;
+            else { out_json.assign(static_cast<const char*>(p), static_cast<size_t>(st.st_size)); munmap(p, static_cast<size_t>(st.st_size)); }
+        }
+        close(outFd);
+        // Plugins that ignore the fd may still write output.json the usual way.
+        if (!got) got = readTextFile(absOutdir / "output.json", out_json);
+
         std::string logtxt; (void)readTextFile(logFile, logtxt);
         std::string errtxt; (void)readTextFile(errFile, errtxt);
+        if (art) capture(*art, code, input, got ? out_json : string(), logtxt, errtxt, ec);
+        if (!got) {
+            out_report = "Plugin wrote nothing to its output fd. Exit=" + std::to_string(ec) +
+                         (errtxt.empty() ? "" : ("\nerr:\n" + errtxt));
+            return false;
+        }
         std::ostringstream rep;
-        rep << "exit=" << ec << "\n";
+        rep << "exit=" << ec << " (memfd)\n";
         if (!logtxt.empty()) rep << "log:\n" << logtxt << "\n";
         if (!errtxt.empty()) rep << "stderr:\n" << errtxt << "\n";
         out_report = rep.str();
         return true;
-
     }
+#endif
 };
 
 } // namespace kernel
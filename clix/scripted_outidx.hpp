@@ -0,0 +1,207 @@
+// scripted_outidx.hpp — random-access index for resolved outputs (`:resolve --index`)
+// C++17 or later, header-only, standalone: downstream tools include only this file.
+//
+// `<out>.idx` sits next to files/out/<ctx>.resolved.txt or <ctx>.json and maps
+// each cell to the byte range of its value inside that output:
+//   header  "SOIX" | u32 version | u64 count | u64 output size | i64 output mtime (ns) | u64 output inode
+//   entries count x (i64 reg, i64 addr, u64 offset, u64 length), sorted by (reg, addr)
+// (host byte order, like the bloom sidecars). The size, mtime and inode pin the
+// output the index was written for; any difference makes the index stale. For .json outputs the range is the
+// string body between the quotes, still JSON-escaped. Reader maps both files and
+// answers a lookup with a binary search over the entries, so nothing is parsed.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace scripted {
+namespace outidx {
+
+struct Entry {
+    int64_t  reg = 0, addr = 0;
+    uint64_t offset = 0, length = 0;
+};
+static_assert(sizeof(Entry) == 32, "index entries are written as raw 32-byte records");
+
+inline constexpr char     kMagic[4] = {'S', 'O', 'I', 'X'};
+inline constexpr uint32_t kVersion = 2;
+inline constexpr size_t   kHeaderBytes = 4 + 4 + 8 + 8 + 8 + 8;
+
+inline std::filesystem::path indexPath(const std::filesystem::path& output) {
+    auto p = output; p += ".idx"; return p;
+}
+
+// Identity of an output file: an in-place rewrite changes the mtime, an atomic
+// replace the inode (0 where there is none).
+struct Stamp {
+    uint64_t size = 0;
+    int64_t  mtimeNs = 0;
+    uint64_t inode = 0;
+    bool operator==(const Stamp& o) const { return size == o.size && mtimeNs == o.mtimeNs && inode == o.inode; }
+    bool operator!=(const Stamp& o) const { return !(*this == o); }
+};
+
+#if !defined(_WIN32)
+inline Stamp stampOf(const struct stat& st) {
+    Stamp s;
+    s.size = static_cast<uint64_t>(st.st_size);
+    #if defined(__APPLE__)
+    s.mtimeNs = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+    #else
+    s.mtimeNs = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    #endif
+    s.inode = static_cast<uint64_t>(st.st_ino);
+    return s;
+}
+#endif
+
+inline bool stampOf(const std::filesystem::path& output, Stamp& s) {
+#if !defined(_WIN32)
+    struct stat st{};
+    if (::stat(output.c_str(), &st) != 0) return false;
+    s = stampOf(st);
+    return true;
+#else
+    std::error_code ec;
+    s.size = std::filesystem::file_size(output, ec);          if (ec) return false;
+    auto mt = std::filesystem::last_write_time(output, ec);   if (ec) return false;
+    s.mtimeNs = static_cast<int64_t>(mt.time_since_epoch().count());
+    s.inode = 0;
+    return true;
+#endif
+}
+
+// Serialises `entries` (already in (reg, addr) order) for the output stamped `out`.
+inline std::string encode(const std::vector<Entry>& entries, const Stamp& out) {
+    std::string s(kHeaderBytes + entries.size() * sizeof(Entry), '\0');
+    uint64_t count = entries.size();
+    std::memcpy(s.data(), kMagic, 4);
+    std::memcpy(s.data() + 4, &kVersion, 4);
+    std::memcpy(s.data() + 8, &count, 8);
+    std::memcpy(s.data() + 16, &out.size, 8);
+    std::memcpy(s.data() + 24, &out.mtimeNs, 8);
+    std::memcpy(s.data() + 32, &out.inode, 8);
+    if (!entries.empty()) std::memcpy(s.data() + kHeaderBytes, entries.data(), entries.size() * sizeof(Entry));
+    return s;
+}
+
+// Read-only view of one output and its index. Lookups return views into the
+// mapped output, valid while the Reader lives.
+class Reader {
+public:
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    Reader(Reader&& o) noexcept { swap(o); }
+    Reader& operator=(Reader&& o) noexcept { if (this != &o) { close(); swap(o); } return *this; }
+    ~Reader() { close(); }
+
+    bool open(const std::filesystem::path& output, std::string& err) {
+        close();
+        if (!map(output, out_, err) || !map(indexPath(output), idx_, err)) { close(); return false; }
+        uint64_t count = 0;
+        uint32_t version = 0;
+        Stamp want;
+        if (idx_.size < 8 || std::memcmp(idx_.base(), kMagic, 4) != 0) { err = "not an output index: " + indexPath(output).string(); close(); return false; }
+        std::memcpy(&version, idx_.base() + 4, 4);
+        if (version != kVersion) { err = "unsupported index version " + std::to_string(version); close(); return false; }
+        if (idx_.size < kHeaderBytes) { err = "truncated index"; close(); return false; }
+        std::memcpy(&count, idx_.base() + 8, 8);
+        std::memcpy(&want.size, idx_.base() + 16, 8);
+        std::memcpy(&want.mtimeNs, idx_.base() + 24, 8);
+        std::memcpy(&want.inode, idx_.base() + 32, 8);
+        if (want.size != out_.stamp.size) { err = "stale index (output is " + std::to_string(out_.stamp.size) + " bytes, index expects " + std::to_string(want.size) + ")"; close(); return false; }
+        if (want != out_.stamp) { err = "stale index (output was rewritten after it)"; close(); return false; }
+        if (count > (idx_.size - kHeaderBytes) / sizeof(Entry) || idx_.size != kHeaderBytes + count * sizeof(Entry)) {
+            err = "truncated index"; close(); return false;
+        }
+        count_ = static_cast<size_t>(count);
+        return true;
+    }
+
+    size_t size() const { return count_; }
+
+    // The value of (reg, addr), or nullopt if the output has no such cell.
+    std::optional<std::string_view> get(int64_t reg, int64_t addr) const {
+        size_t lo = 0, hi = count_;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            Entry e = at(mid);
+            if (e.reg < reg || (e.reg == reg && e.addr < addr)) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == count_) return std::nullopt;
+        Entry e = at(lo);
+        if (e.reg != reg || e.addr != addr || e.offset > out_.size || e.length > out_.size - e.offset) return std::nullopt;
+        return std::string_view(out_.base() + e.offset, static_cast<size_t>(e.length));
+    }
+
+    Entry at(size_t i) const {
+        Entry e;
+        std::memcpy(&e, idx_.base() + kHeaderBytes + i * sizeof(Entry), sizeof(Entry));
+        return e;
+    }
+
+private:
+    struct Mapping {
+        const char* data = nullptr;  // mmap'ed bytes, or null when read into `copy`
+        size_t size = 0;
+        Stamp stamp;
+        std::string copy;
+        const char* base() const { return data ? data : copy.data(); }
+    };
+    Mapping out_, idx_;
+    size_t count_ = 0;
+
+    static bool map(const std::filesystem::path& p, Mapping& m, std::string& err) {
+#if !defined(_WIN32)
+        int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { err = "cannot open " + p.string(); return false; }
+        struct stat st{};
+        if (fstat(fd, &st) != 0) { ::close(fd); err = "cannot stat " + p.string(); return false; }
+        m.size = static_cast<size_t>(st.st_size);
+        m.stamp = stampOf(st);
+        if (m.size == 0) { ::close(fd); return true; }
+        void* v = mmap(nullptr, m.size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (v == MAP_FAILED) { err = "cannot map " + p.string(); return false; }
+        m.data = static_cast<const char*>(v);
+        return true;
+#else
+        std::ifstream in(p, std::ios::binary);
+        if (!in) { err = "cannot open " + p.string(); return false; }
+        m.copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m.size = m.copy.size();
+        if (!stampOf(p, m.stamp)) { err = "cannot stat " + p.string(); return false; }
+        return true;
+#endif
+    }
+    static void unmap(Mapping& m) {
+#if !defined(_WIN32)
+        if (m.data) munmap(const_cast<char*>(m.data), m.size);
+#endif
+        m = Mapping{};
+    }
+    void close() { unmap(out_); unmap(idx_); count_ = 0; }
+    void swap(Reader& o) noexcept {
+        std::swap(out_, o.out_); std::swap(idx_, o.idx_); std::swap(count_, o.count_);
+    }
+};
+
+} // namespace outidx
+} // namespace scripted
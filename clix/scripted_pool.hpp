@@ -0,0 +1,222 @@
+// scripted_pool.hpp — process-wide executor with interactive and background classes
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// One pool of worker threads (shared()) runs every task the CLI does not run on
+// its own thread: :bg jobs and the parallel parts of commands (parallelFor).
+// Each worker owns a deque per priority class; it pops its own newest task and,
+// when empty, steals the oldest from another worker. Interactive tasks always go
+// before background ones, and no background task starts while an interactive
+// command is running (an InteractiveScope is alive). Background tasks that are
+// already running pause at their next safe point: the CancelToken they poll
+// per cell or bank carries a yield hook that calls pauseForInteractive().
+#pragma once
+#include "scripted_core.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scripted {
+namespace pool {
+
+enum class Priority { Interactive = 0, Background = 1 };
+
+class Executor {
+public:
+    using Task = std::function<void()>;
+
+    struct Stats {
+        unsigned workers = 0;
+        size_t   queued[2] = {0, 0};     // by Priority
+        uint64_t executed = 0, stolen = 0;
+        int      interactive = 0;        // live InteractiveScopes
+        int      paused = 0;             // background tasks waiting in pauseForInteractive
+    };
+
+    explicit Executor(unsigned threads) {
+        threads = std::max(1u, threads);
+        for (unsigned i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+        for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { loop(i); });
+    }
+    ~Executor() {
+        {
+            std::lock_guard lk(sleepMu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        nudge();
+        for (auto& t : threads_) t.join();
+    }
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // From a worker the task goes to that worker's deque, else round-robin.
+    void submit(Task fn, Priority p) {
+        size_t w = self_ >= 0 && owner_ == this ? size_t(self_) : rr_.fetch_add(1) % workers_.size();
+        {
+            std::lock_guard lk(workers_[w]->mu);
+            workers_[w]->q[int(p)].push_back(std::move(fn));
+        }
+        pending_[int(p)].fetch_add(1);
+        std::lock_guard lk(sleepMu_);
+        wake_.notify_one();
+    }
+
+    // Runs fn(i) for i in [0, n) at the calling thread's priority and returns when
+    // all are done. The caller takes indices too, and helpers that start after it
+    // has finished do nothing, so this never waits on a task stuck in a queue.
+    template <class Fn>
+    void parallelFor(size_t n, size_t maxThreads, Fn&& fn) {
+        if (n == 0) return;
+        struct Shared {
+            std::atomic<size_t> next{0};
+            std::mutex mu;
+            std::condition_variable cv;
+            size_t running = 0;
+            bool closed = false;
+        };
+        auto sh = std::make_shared<Shared>();
+        auto drain = [&sh, n, &fn] { for (size_t i; (i = sh->next.fetch_add(1)) < n; ) fn(i); };
+        size_t helpers = std::min({n, std::max<size_t>(1, maxThreads), workers_.size() + 1}) - 1;
+        for (size_t h = 0; h < helpers; ++h)
+            submit([sh, n, &fn] {
+                {
+                    std::lock_guard lk(sh->mu);
+                    if (sh->closed) return;   // the caller is gone; `fn` may be too
+                    ++sh->running;
+                }
+                for (size_t i; (i = sh->next.fetch_add(1)) < n; ) fn(i);
+                std::lock_guard lk(sh->mu);
+                if (--sh->running == 0) sh->cv.notify_all();
+            }, currentPriority());
+        drain();
+        std::unique_lock lk(sh->mu);
+        sh->closed = true;
+        sh->cv.wait(lk, [&] { return sh->running == 0; });
+    }
+
+    // Called by background work at safe points: blocks while interactive work runs,
+    // or until `*stop` is set (then nudge()).
+    void pauseForInteractive(const std::atomic<bool>* stop = nullptr) {
+        if (interactive_.load(std::memory_order_acquire) == 0) return;
+        std::unique_lock lk(gateMu_);
+        ++paused_;
+        gateCv_.wait(lk, [&] { return interactive_.load() == 0 || stop_ || (stop && stop->load()); });
+        --paused_;
+    }
+    bool interactiveActive() const { return interactive_.load(std::memory_order_acquire) > 0; }
+    // Wakes paused background work so it can notice `stop`.
+    void nudge() { std::lock_guard lk(gateMu_); gateCv_.notify_all(); }
+
+    // While alive, queued background tasks wait and running ones pause.
+    class InteractiveScope {
+    public:
+        explicit InteractiveScope(Executor& e) : e_(e) { e_.interactive_.fetch_add(1, std::memory_order_acq_rel); }
+        ~InteractiveScope() {
+            if (e_.interactive_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            { std::lock_guard lk(e_.gateMu_); e_.gateCv_.notify_all(); }
+            std::lock_guard lk(e_.sleepMu_);
+            e_.wake_.notify_all();
+        }
+        InteractiveScope(const InteractiveScope&) = delete;
+        InteractiveScope& operator=(const InteractiveScope&) = delete;
+    private:
+        Executor& e_;
+    };
+
+    Stats stats() const {
+        Stats s;
+        s.workers = unsigned(workers_.size());
+        for (auto& w : workers_) {
+            std::lock_guard lk(w->mu);
+            s.queued[0] += w->q[0].size();
+            s.queued[1] += w->q[1].size();
+        }
+        s.executed = executed_.load();
+        s.stolen = stolen_.load();
+        s.interactive = interactive_.load();
+        std::lock_guard lk(gateMu_);
+        s.paused = paused_;
+        return s;
+    }
+
+    // Priority of the task running on this thread; Interactive off the pool.
+    static Priority currentPriority() { return priority_; }
+
+private:
+    struct Worker {
+        std::mutex mu;
+        std::deque<Task> q[2];
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<unsigned> rr_{0};
+    std::atomic<size_t> pending_[2] = {0, 0};
+    std::atomic<uint64_t> executed_{0}, stolen_{0};
+    std::atomic<int> interactive_{0};
+    mutable std::mutex sleepMu_, gateMu_;
+    std::condition_variable wake_, gateCv_;
+    int paused_ = 0;
+    std::atomic<bool> stop_{false};
+
+    static inline thread_local int self_ = -1;
+    static inline thread_local const Executor* owner_ = nullptr;
+    static inline thread_local Priority priority_ = Priority::Interactive;
+
+    // Own deque newest-first, then the oldest of a victim's; interactive class first.
+    bool take(size_t self, Task& out, Priority& p) {
+        const size_t n = workers_.size();
+        for (int cls = 0; cls < 2; ++cls) {
+            if (cls == 1 && interactive_.load(std::memory_order_acquire) > 0) return false;
+            for (size_t k = 0; k < n; ++k) {
+                Worker& w = *workers_[(self + k) % n];
+                std::lock_guard lk(w.mu);
+                auto& q = w.q[cls];
+                if (q.empty()) continue;
+                if (k == 0) { out = std::move(q.back()); q.pop_back(); }
+                else { out = std::move(q.front()); q.pop_front(); ++stolen_; }
+                p = Priority(cls);
+                pending_[cls].fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+    void execute(Task& t, Priority p) {
+        Priority before = priority_;
+        priority_ = p;
+        t();
+        priority_ = before;
+        ++executed_;
+    }
+    void loop(size_t self) {
+        self_ = int(self);
+        owner_ = this;
+        priority_ = Priority::Background;
+        for (;;) {
+            Task t; Priority p;
+            if (take(self, t, p)) { execute(t, p); continue; }
+            std::unique_lock lk(sleepMu_);
+            if (stop_) return;
+            // Woken by submit, or when the last InteractiveScope ends (background may start).
+            wake_.wait_for(lk, std::chrono::milliseconds(50), [&] {
+                return stop_ || pending_[0].load() > 0 || (pending_[1].load() > 0 && interactive_.load() == 0);
+            });
+            if (stop_) return;
+        }
+    }
+};
+
+// The process-wide pool: one worker per core.
+inline Executor& shared() {
+    static Executor e(std::max(1u, std::thread::hardware_concurrency()));
+    return e;
+}
+
+} // namespace pool
+} // namespace scripted
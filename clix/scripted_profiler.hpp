@@ -0,0 +1,191 @@
+// scripted_profiler.hpp — in-process sampling profiler (`:profile start/stop`)
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// setitimer(ITIMER_PROF) delivers SIGPROF at `hz` per second of CPU time; the
+// handler unwinds with backtrace() into a buffer allocated at start and claims
+// slots with one atomic increment, so it never locks or allocates. Each sample
+// also records the label of the command running at the time (set by the CLI,
+// e.g. ":resolve;bank x00001"). stop() symbolises with dladdr and writes folded
+// stacks ("label;outer;...;inner count") for flamegraph.pl / speedscope.
+// Executables linked without -rdynamic show their own frames as
+// "scripted+0xOFFSET" (resolve with addr2line). POSIX with <execinfo.h> only.
+#pragma once
+#include "scripted_core.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32) && __has_include(<execinfo.h>)
+    #define SCRIPTED_PROFILER 1
+    #include <cerrno>
+    #include <csignal>
+    #include <cxxabi.h>
+    #include <dlfcn.h>
+    #include <execinfo.h>
+    #include <sys/time.h>
+#endif
+
+namespace scripted {
+namespace prof {
+
+using std::string;
+
+struct Summary {
+    size_t samples = 0, dropped = 0, stacks = 0;
+    double seconds = 0;
+};
+
+#if defined(SCRIPTED_PROFILER)
+namespace detail {
+inline constexpr int      kMaxDepth = 48;
+inline constexpr uint32_t kCapacity = 1u << 15;   // ~5.5 min at 99 Hz, ~12.5 MB
+inline constexpr int      kSkip = 2;              // handler + signal trampoline
+
+struct Sample {
+    int      depth;
+    uint32_t label;
+    void*    frames[kMaxDepth];
+};
+
+struct State {
+    std::unique_ptr<Sample[]> samples;
+    std::atomic<uint32_t> next{0}, written{0}, dropped{0};
+    std::atomic<uint32_t> label{0};
+    std::atomic<bool>     running{false};
+    std::vector<string>   labels{"(idle)"};      // touched by the CLI thread only
+    std::map<string, uint32_t> labelIds{{"(idle)", 0}};
+    struct sigaction      oldAction{};
+    std::chrono::steady_clock::time_point t0;
+};
+inline State& state() { static State s; return s; }
+
+inline void onSigprof(int, siginfo_t*, void*) {
+    int savedErrno = errno;
+    State& S = state();
+    uint32_t i = S.next.fetch_add(1, std::memory_order_relaxed);
+    if (i < kCapacity) {
+        Sample& s = S.samples[i];
+        s.label = S.label.load(std::memory_order_relaxed);
+        s.depth = backtrace(s.frames, kMaxDepth);
+        S.written.fetch_add(1, std::memory_order_release);
+    } else {
+        S.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    errno = savedErrno;
+}
+
+inline string symbolName(void* pc) {
+    Dl_info info{};
+    if (dladdr(pc, &info) && info.dli_sname) {
+        int status = 0;
+        char* dem = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        string name = (status == 0 && dem) ? dem : info.dli_sname;
+        std::free(dem);
+        for (char& c : name) if (c == ';') c = ':';
+        return name;
+    }
+    string mod = info.dli_fname ? fs::path(info.dli_fname).filename().string() : string("?");
+    char off[32];
+    std::snprintf(off, sizeof(off), "+0x%zx", static_cast<size_t>(
+        static_cast<const char*>(pc) - static_cast<const char*>(info.dli_fbase)));
+    return mod + off;
+}
+} // namespace detail
+
+inline bool running() { return detail::state().running.load(); }
+
+// Tags subsequent samples with `label` (cheap no-op while not profiling).
+inline void setContext(const string& label) {
+    auto& S = detail::state();
+    if (!S.running.load(std::memory_order_relaxed)) return;
+    auto [it, fresh] = S.labelIds.try_emplace(label, static_cast<uint32_t>(S.labels.size()));
+    if (fresh) S.labels.push_back(label);
+    S.label.store(it->second, std::memory_order_relaxed);
+}
+
+inline bool start(int hz, string& err) {
+    auto& S = detail::state();
+    if (S.running) { err = "profiler already running"; return false; }
+    if (hz < 1 || hz > 10000) { err = "hz must be 1..10000"; return false; }
+    if (!S.samples) S.samples = std::make_unique<detail::Sample[]>(detail::kCapacity);
+    void* warm[2];
+    (void)backtrace(warm, 2);   // first call may load libgcc; never do that inside the handler
+    S.next = 0; S.written = 0; S.dropped = 0; S.label = 0;
+
+    struct sigaction sa{};
+    sa.sa_sigaction = detail::onSigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &S.oldAction) != 0) { err = "sigaction(SIGPROF) failed"; return false; }
+    itimerval tv{};
+    tv.it_interval.tv_sec  = hz == 1 ? 1 : 0;
+    tv.it_interval.tv_usec = hz == 1 ? 0 : 1000000 / hz;
+    tv.it_value = tv.it_interval;
+    S.running = true;
+    S.t0 = std::chrono::steady_clock::now();
+    if (setitimer(ITIMER_PROF, &tv, nullptr) != 0) {
+        S.running = false;
+        sigaction(SIGPROF, &S.oldAction, nullptr);
+        err = "setitimer(ITIMER_PROF) failed";
+        return false;
+    }
+    return true;
+}
+
+// Stops sampling and writes folded stacks to `out`.
+inline bool stop(const fs::path& out, Summary& sum, string& err) {
+    auto& S = detail::state();
+    if (!S.running) { err = "profiler not running"; return false; }
+    itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    sum.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - S.t0).count();
+    // Let a handler that is mid-flight on another thread finish before reading.
+    uint32_t claimed = std::min(S.next.load(), detail::kCapacity);
+    for (int i = 0; i < 100 && S.written.load(std::memory_order_acquire) < claimed; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // A SIGPROF may still be pending on some thread. Restoring SIG_DFL would let it
+    // terminate the process, so a default disposition becomes SIG_IGN instead.
+    struct sigaction after = S.oldAction;
+    if (!(after.sa_flags & SA_SIGINFO) && after.sa_handler == SIG_DFL) after.sa_handler = SIG_IGN;
+    sigaction(SIGPROF, &after, nullptr);
+    S.running = false;
+
+    sum.samples = S.written.load(std::memory_order_acquire);
+    sum.dropped = S.dropped.load();
+    std::map<void*, string> names;
+    std::map<string, size_t> folded;
+    for (size_t i = 0; i < sum.samples; ++i) {
+        const auto& s = S.samples[i];
+        string key = S.labels[s.label];
+        if (s.depth == detail::kMaxDepth) key += ";[truncated]"; // root frames lost
+        for (int f = s.depth - 1; f >= detail::kSkip; --f) {
+            auto [it, fresh] = names.try_emplace(s.frames[f]);
+            if (fresh) it->second = detail::symbolName(s.frames[f]);
+            key += ';';
+            key += it->second;
+        }
+        ++folded[key];
+    }
+    sum.stacks = folded.size();
+    fs::create_directories(out.parent_path().empty() ? fs::path(".") : out.parent_path());
+    std::ofstream os(out, std::ios::binary | std::ios::trunc);
+    if (!os) { err = "cannot write " + out.string(); return false; }
+    for (auto& [stack, n] : folded) os << stack << ' ' << n << '\n';
+    return static_cast<bool>(os);
+}
+#else
+inline bool running() { return false; }
+inline void setContext(const string&) {}
+inline bool start(int, string& err) { err = "profiler not available on this platform"; return false; }
+inline bool stop(const fs::path&, Summary&, string& err) { err = "profiler not running"; return false; }
+#endif
+
+} // namespace prof
+} // namespace scripted
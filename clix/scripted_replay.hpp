@@ -0,0 +1,229 @@
+// scripted_replay.hpp — session recording and replay (--record / --replay)
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// A recording is a text file: a few `# key value` header lines, then one line
+// per command the session ran, tab-separated:
+//   <start ms since session start> <wall ms> <ok|unknown|failed|quit> <command>
+// Lines are flushed as they are written, so a crashed session keeps its history.
+// When recording starts, files/ (except out/) is copied to <recording>.ws/files
+// and fingerprinted. A replay copies that snapshot into a scratch directory, runs
+// the commands there in order, keeping the recorded pauses between them (scaled
+// by --speed, or none with --speed max), and compares each command's wall time
+// and result with the recording.
+#pragma once
+#include "scripted_core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scripted {
+namespace replay {
+
+using std::string;
+
+struct Entry {
+    double atMs = 0;     // start, since the session started
+    double ms = 0;       // wall time
+    string result;       // ok | unknown | failed | quit
+    string command;
+};
+
+struct Session {
+    std::map<string, string> header;   // fingerprint, platform, cores, started
+    std::vector<Entry> entries;
+};
+
+inline fs::path snapshotDir(const fs::path& recording) { fs::path p = recording; p += ".ws"; return p; }
+
+// FNV-1a over the relative path, size and bytes of every regular file under
+// `root` except out/, in path order.
+inline string fingerprint(const fs::path& root) {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](const char* p, size_t n) { for (size_t i = 0; i < n; ++i) { h ^= uint8_t(p[i]); h *= 1099511628211ull; } };
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it.depth() == 0 && it->path().filename() == "out") { it.disable_recursion_pending(); continue; }
+        if (it->is_regular_file(ec)) files.push_back(it->path());
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<char> buf(1 << 16);
+    for (auto& f : files) {
+        string rel = f.lexically_relative(root).generic_string();
+        mix(rel.data(), rel.size() + 1);
+        std::ifstream in(f, std::ios::binary);
+        uint64_t size = 0;
+        while (in.read(buf.data(), std::streamsize(buf.size())) || in.gcount() > 0) {
+            mix(buf.data(), size_t(in.gcount()));
+            size += uint64_t(in.gcount());
+        }
+        mix(reinterpret_cast<const char*>(&size), sizeof size);
+    }
+    char out[17];
+    std::snprintf(out, sizeof out, "%016llx", (unsigned long long)h);
+    return out;
+}
+
+// Copies the workspace `from` (a files/ directory) to `to`, leaving out out/.
+inline bool copyWorkspace(const fs::path& from, const fs::path& to, string& err) {
+    std::error_code ec;
+    fs::create_directories(to, ec);
+    for (auto it = fs::recursive_directory_iterator(from, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it.depth() == 0 && it->path().filename() == "out") { it.disable_recursion_pending(); continue; }
+        fs::path dst = to / it->path().lexically_relative(from);
+        if (it->is_directory(ec)) fs::create_directories(dst, ec);
+        else if (it->is_regular_file(ec)) fs::copy_file(it->path(), dst, fs::copy_options::overwrite_existing, ec);
+        if (ec) { err = "copy " + it->path().string() + ": " + ec.message(); return false; }
+    }
+    if (ec) { err = from.string() + ": " + ec.message(); return false; }
+    return true;
+}
+
+// Commands are one line each; tabs, newlines and backslashes are escaped.
+inline string escape(const string& s) {
+    string o;
+    for (char c : s) {
+        if (c == '\\') o += "\\\\";
+        else if (c == '\t') o += "\\t";
+        else if (c == '\n') o += "\\n";
+        else if (c == '\r') o += "\\r";
+        else o.push_back(c);
+    }
+    return o;
+}
+inline string unescape(const string& s) {
+    string o;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) { o.push_back(s[i]); continue; }
+        char c = s[++i];
+        o.push_back(c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c);
+    }
+    return o;
+}
+
+class Recorder {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // Snapshots files/ next to `file`, then starts the recording. `file` must not
+    // be under files/: the snapshot would then copy itself.
+    bool open(const fs::path& file, const Paths& P, string& err) {
+        fs::path snap = snapshotDir(file);
+        std::error_code ec;
+        fs::path root = fs::weakly_canonical(P.root, ec), at = fs::weakly_canonical(fs::absolute(file), ec);
+        auto rel = at.lexically_relative(root);
+        if (!rel.empty() && *rel.begin() != "..") { err = file.string() + " is inside " + P.root.string() + "/; record elsewhere"; return false; }
+        fs::remove_all(snap, ec);
+        if (!copyWorkspace(P.root, snap / "files", err)) return false;
+        out_.open(file, std::ios::binary | std::ios::trunc);
+        if (!out_) { err = "Cannot write " + file.string(); return false; }
+        out_ << "# scripted-session 1\n"
+             << "# fingerprint " << fingerprint(snap / "files") << "\n"
+             << "# platform " << platformName() << "\n"
+             << "# cores " << std::thread::hardware_concurrency() << "\n"
+             << "# started " << std::chrono::duration_cast<std::chrono::seconds>(
+                                    std::chrono::system_clock::now().time_since_epoch()).count() << "\n";
+        out_.flush();
+        t0_ = clock::now();
+        return true;
+    }
+    double elapsedMs() const { return std::chrono::duration<double, std::milli>(clock::now() - t0_).count(); }
+    void add(const Entry& e) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3) << e.atMs << '\t' << e.ms << '\t' << e.result << '\t' << escape(e.command) << '\n';
+        out_ << os.str();
+        out_.flush();
+    }
+
+private:
+    std::ofstream out_;
+    clock::time_point t0_ = clock::now();
+};
+
+inline bool load(const fs::path& file, Session& s, string& err) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) { err = "Cannot read " + file.string(); return false; }
+    size_t lineNo = 0;
+    for (string line; std::getline(in, line);) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            size_t sp = line.find(' ', 2);
+            if (line.size() > 2) s.header[line.substr(2, sp == string::npos ? sp : sp - 2)] = sp == string::npos ? "" : line.substr(sp + 1);
+            continue;
+        }
+        std::vector<string> f;
+        for (size_t a = 0, b; f.size() < 3 && (b = line.find('\t', a)) != string::npos; a = b + 1) f.push_back(line.substr(a, b - a));
+        Entry e;
+        try {
+            if (f.size() != 3) throw std::invalid_argument("fields");
+            e.atMs = std::stod(f[0]);
+            e.ms = std::stod(f[1]);
+        } catch (const std::exception&) {
+            err = file.string() + ":" + std::to_string(lineNo) + ": expected <at ms> <ms> <result> <command>";
+            return false;
+        }
+        e.result = f[2];
+        size_t cmd = 0;
+        for (int tabs = 0; tabs < 3; ++tabs) cmd = line.find('\t', cmd) + 1;
+        e.command = unescape(line.substr(cmd));
+        s.entries.push_back(std::move(e));
+    }
+    if (s.header.count("scripted-session") == 0) { err = file.string() + ": not a session recording"; return false; }
+    return true;
+}
+
+struct Row {
+    Entry  recorded;
+    double ms = 0;           // replay wall time
+    string result;
+    bool   slower = false;   // beyond the tolerance
+};
+
+struct Report {
+    std::vector<Row> rows;
+    double recordedMs = 0, replayMs = 0;   // sums of command wall time
+    int    slower = 0, mismatched = 0;     // mismatched: different result
+    string fingerprint;                     // of the replayed copy
+    bool   fingerprintMatches = true;
+};
+
+// A command is slower when it took more than (1 + tolerancePct/100) times as long
+// and at least minDeltaMs more, so sub-millisecond noise is not flagged.
+inline void judge(Report& r, double tolerancePct, double minDeltaMs = 2.0) {
+    r.recordedMs = r.replayMs = 0;
+    r.slower = r.mismatched = 0;
+    for (auto& row : r.rows) {
+        r.recordedMs += row.recorded.ms;
+        r.replayMs += row.ms;
+        row.slower = row.ms > row.recorded.ms * (1 + tolerancePct / 100) && row.ms - row.recorded.ms >= minDeltaMs;
+        r.slower += row.slower;
+        r.mismatched += row.result != row.recorded.result;
+    }
+}
+
+inline string toTSV(const Report& r) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "n\trecorded_ms\treplay_ms\tdelta_ms\tratio\trecorded_result\treplay_result\tslower\tcommand\n";
+    for (size_t i = 0; i < r.rows.size(); ++i) {
+        auto& row = r.rows[i];
+        os << i + 1 << '\t' << row.recorded.ms << '\t' << row.ms << '\t' << row.ms - row.recorded.ms << '\t'
+           << (row.recorded.ms > 0 ? row.ms / row.recorded.ms : 0.0) << '\t' << row.recorded.result << '\t'
+           << row.result << '\t' << (row.slower ? 1 : 0) << '\t' << escape(row.recorded.command) << '\n';
+    }
+    return os.str();
+}
+
+} // namespace replay
+} // namespace scripted
@@ -0,0 +1,444 @@
+// scripted_sched.hpp — host-wide fair-share scheduler for plugin jobs
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// One server process per host (`scripted --sched-server`) owns a Unix socket;
+// every CLI session's Kernel asks it for a slot before spawning a plugin and
+// gives it back when the child exits. Line protocol, one connection per job:
+//   ACQUIRE <client> <weight> <interactive|batch>   -> WAIT <pos>... GO <waited_us>
+//   DONE                                             (or just disconnect)
+//   STATS                                            -> key value lines, END
+// The server trusts none of the ACQUIRE fields: the client is the peer's user
+// (SO_PEERCRED / getpeereid), its weight comes from --weight and the request can
+// only lower it, and each client has at most kInteractivePerClient interactive
+// jobs queued or running; further ones are batch. Waiting jobs sit in per-client
+// queues. Interactive jobs are always granted before batch ones (running jobs
+// are never preempted); within a class the client with the least weighted
+// service goes next. The slot cap defaults to min(cores, MemAvailable / per-job
+// memory). Queued jobs get a WAIT line every kKeepaliveMs. With no server
+// running, clients proceed unscheduled; so do they when the server does not
+// accept within kConnectMs or goes silent for $SCRIPTED_SCHED_TIMEOUT seconds,
+// so a hung server cannot stall a session while a long queue still holds jobs
+// back. The socket is per user unless $SCRIPTED_SCHED names a shared one.
+#pragma once
+#include "scripted_core.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+    #include <pwd.h>
+#endif
+
+namespace scripted {
+namespace sched {
+
+using std::string;
+
+constexpr int kConnectMs = 500;
+constexpr int kKeepaliveMs = 1000;
+constexpr int kInteractivePerClient = 1;
+
+// A path set in $SCRIPTED_SCHED is shared (e.g. by every user of a build host);
+// the default is private to the user.
+inline bool sharedSocket() { return std::getenv("SCRIPTED_SCHED") != nullptr; }
+inline string socketPath() {
+    if (const char* e = std::getenv("SCRIPTED_SCHED")) return e;
+    if (const char* e = std::getenv("XDG_RUNTIME_DIR"); e && *e) return string(e) + "/scripted-sched.sock";
+#if !defined(_WIN32)
+    return "/tmp/scripted-sched-" + std::to_string(getuid()) + ".sock";
+#else
+    return "";
+#endif
+}
+// How long acquire() waits without hearing from the server before running
+// unscheduled. A queued job hears a WAIT line every kKeepaliveMs, so only a
+// hung server trips this, never a long queue.
+inline int silenceTimeoutMs() {
+    if (const char* e = std::getenv("SCRIPTED_SCHED_TIMEOUT")) { int s = std::atoi(e); if (s > 0) return s * 1000; }
+    return 10000;
+}
+
+// Sent for :sched output only; the server names clients by the peer's uid.
+inline string clientName() {
+#if !defined(_WIN32)
+    if (passwd* pw = getpwuid(getuid())) return pw->pw_name;
+#endif
+    if (const char* e = std::getenv("USER")) return e;
+    return "anon";
+}
+// A hint: the server grants min(this, the weight it was given for the user).
+inline int clientWeight() {
+    if (const char* e = std::getenv("SCRIPTED_SCHED_WEIGHT")) { int w = std::atoi(e); if (w > 0) return w; }
+    return 1;
+}
+
+#if !defined(_WIN32)
+// Non-blocking; a server whose backlog is full counts as not running.
+inline int connectSocket(const string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    sockaddr_un sa{}; sa.sun_family = AF_UNIX;
+    std::snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path.c_str());
+    if (connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+        pollfd p{fd, POLLOUT, 0};
+        int soErr = 0; socklen_t len = sizeof soErr;
+        if (errno != EINPROGRESS || poll(&p, 1, kConnectMs) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &soErr, &len) != 0 || soErr != 0) { close(fd); return -1; }
+    }
+    return fd;
+}
+// Client side: the private default socket must be ours, so another user cannot
+// squat on the path and hold our plugin runs.
+inline int connectServer() {
+    string path = socketPath();
+    struct stat st{};
+    if (path.empty() || lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) return -1;
+    if (!sharedSocket() && st.st_uid != getuid()) return -1;
+    return connectSocket(path);
+}
+inline bool sendAll(int fd, const string& s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd p{fd, POLLOUT, 0};
+            if (poll(&p, 1, kConnectMs) == 1) continue;
+        }
+        if (n <= 0) return false;
+        off += size_t(n);
+    }
+    return true;
+}
+// false on EOF, error or when `timeoutMs` (-1: none) passes without a full line.
+inline bool readLine(int fd, string& line, int timeoutMs = -1) {
+    line.clear();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    char c;
+    while (true) {
+        ssize_t n = recv(fd, &c, 1, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            int left = timeoutMs < 0 ? -1 : int(std::max<long long>(0,
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count()));
+            pollfd p{fd, POLLIN, 0};
+            int r = poll(&p, 1, left);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            continue;
+        }
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line.push_back(c);
+    }
+}
+// Login name of the process at the other end of `fd`, as the kernel reports it.
+inline bool peerUser(int fd, string& name) {
+    uid_t uid;
+#if defined(SO_PEERCRED)
+    ucred cr{}; socklen_t len = sizeof cr;
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &len) != 0) return false;
+    uid = cr.uid;
+#else
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0) return false;
+#endif
+    if (passwd* pw = getpwuid(uid)) name = pw->pw_name;
+    else name = "uid" + std::to_string(uid);
+    return true;
+}
+#endif
+
+// Held for the lifetime of one plugin job; releases the slot on destruction.
+struct Ticket {
+    int    fd = -1;
+    bool   scheduled = false;   // false: no server, ran unscheduled
+    bool   timedOut = false;    // the server went silent; ran unscheduled
+    long long waitedUs = 0;
+
+    Ticket() = default;
+    Ticket(const Ticket&) = delete;
+    Ticket& operator=(const Ticket&) = delete;
+    Ticket(Ticket&& o) noexcept : fd(o.fd), scheduled(o.scheduled), timedOut(o.timedOut), waitedUs(o.waitedUs) { o.fd = -1; }
+    ~Ticket() { release(); }
+    void release() {
+#if !defined(_WIN32)
+        if (fd >= 0) { (void)sendAll(fd, "DONE\n"); close(fd); }
+#endif
+        fd = -1;
+    }
+};
+
+// Blocks until the host scheduler grants a slot, however long the queue. Returns
+// unscheduled at once when no server is listening, and when the server sends
+// nothing (not even WAIT) for silenceTimeoutMs().
+inline Ticket acquire(bool interactive) {
+    Ticket t;
+#if !defined(_WIN32)
+    int fd = connectServer();
+    if (fd < 0) return t;
+    string line;
+    if (!sendAll(fd, "ACQUIRE " + clientName() + " " + std::to_string(clientWeight()) + " " +
+                     (interactive ? "interactive" : "batch") + "\n")) { close(fd); return t; }
+    const int silence = silenceTimeoutMs();
+    while (true) {
+        auto t0 = std::chrono::steady_clock::now();
+        bool got = readLine(fd, line, silence);
+        if (got && line.rfind("WAIT ", 0) == 0) continue;
+        if (got && line.rfind("GO ", 0) == 0) break;
+        t.timedOut = !got && std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds(silence);
+        close(fd);   // the server drops our queue entry
+        return t;
+    }
+    t.fd = fd; t.scheduled = true;
+    t.waitedUs = std::atoll(line.c_str() + 3);
+#else
+    (void)interactive;
+#endif
+    return t;
+}
+
+// STATS from the running server, or empty if none.
+inline string queryStats() {
+    string out;
+#if !defined(_WIN32)
+    int fd = connectServer();
+    if (fd < 0) return out;
+    string line;
+    if (sendAll(fd, "STATS\n"))
+        while (readLine(fd, line, 2000) && line != "END") out += line + "\n";
+    close(fd);
+#endif
+    return out;
+}
+
+// Slots: min(cores, MemAvailable / jobMemMB), at least 1.
+inline int defaultSlots(long long jobMemMB) {
+    int cores = int(std::max(1u, std::thread::hardware_concurrency()));
+#if defined(__linux__)
+    std::ifstream mi("/proc/meminfo");
+    string key; long long kb = 0; string unit;
+    while (mi >> key >> kb >> unit) {
+        if (key == "MemAvailable:") {
+            long long bySlots = kb / 1024 / std::max(1LL, jobMemMB);
+            return int(std::max(1LL, std::min<long long>(cores, bySlots)));
+        }
+    }
+#else
+    (void)jobMemMB;
+#endif
+    return cores;
+}
+
+#if !defined(_WIN32)
+class Server {
+public:
+    // `weights`: fair-share weight per user name; users not listed get 1.
+    Server(string path, int slots, std::map<string, int> weights = {})
+        : path_(std::move(path)), slots_(std::max(1, slots)), weights_(std::move(weights)) {}
+
+    int run() {
+        ::signal(SIGPIPE, SIG_IGN);
+        if (int probe = connectSocket(path_); probe >= 0) {
+            close(probe);
+            std::cerr << "scheduler already running on " << path_ << "\n";
+            return 1;
+        }
+        ::unlink(path_.c_str());
+        int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un sa{}; sa.sun_family = AF_UNIX;
+        std::snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path_.c_str());
+        if (lfd < 0 || bind(lfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || listen(lfd, 128) != 0) {
+            std::cerr << "cannot listen on " << path_ << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        ::chmod(path_.c_str(), sharedSocket() ? 0666 : 0600);   // $SCRIPTED_SCHED: every user's sessions
+        std::cout << "scheduler on " << path_ << " with " << slots_ << " slot(s)\n";
+
+        auto lastBeat = Clock::now();
+        while (true) {
+            std::vector<pollfd> pfds{{lfd, POLLIN, 0}};
+            for (auto& [fd, c] : conns_) pfds.push_back({fd, POLLIN, 0});
+            if (poll(pfds.data(), pfds.size(), kKeepaliveMs) < 0) { if (errno == EINTR) continue; break; }
+            if (pfds[0].revents & POLLIN) {
+                int cfd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+                Conn c;
+                if (cfd >= 0 && peerUser(cfd, c.user)) conns_[cfd] = std::move(c);
+                else if (cfd >= 0) close(cfd);
+            }
+            for (size_t i = 1; i < pfds.size(); ++i)
+                if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) onReadable(pfds[i].fd);
+            dispatch();
+            if (Clock::now() - lastBeat >= std::chrono::milliseconds(kKeepaliveMs)) {
+                keepalive();
+                lastBeat = Clock::now();
+            }
+        }
+        close(lfd);
+        return 0;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum class State { Idle, Queued, Running };
+    struct Conn {
+        string buf, user;
+        bool interactive = false;
+        State state = State::Idle;
+        Clock::time_point queuedAt{};
+    };
+    struct Client {
+        int    weight = 1;
+        double vtime = 0;                 // weighted service received
+        std::deque<int> queue;            // waiting conns, FIFO
+        size_t running = 0;
+        size_t interactive = 0;           // interactive jobs queued or running
+        unsigned long long granted = 0;
+    };
+    struct WaitStats { unsigned long long n = 0; double totalUs = 0, maxUs = 0; };
+
+    string path_;
+    int slots_;
+    int running_ = 0;
+    std::map<string, int> weights_;
+    std::map<int, Conn> conns_;
+    std::map<string, Client> clients_;
+    WaitStats wait_[2];                   // [batch, interactive]
+
+    void onReadable(int fd) {
+        char tmp[512];
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0) { drop(fd); return; }
+        auto& c = conns_[fd];
+        c.buf.append(tmp, size_t(n));
+        size_t nl;
+        while ((nl = c.buf.find('\n')) != string::npos) {
+            string line = c.buf.substr(0, nl);
+            c.buf.erase(0, nl + 1);
+            if (!handle(fd, line)) { drop(fd); return; }
+        }
+    }
+
+    bool handle(int fd, const string& line) {
+        std::istringstream is(line);
+        string cmd; is >> cmd;
+        auto& c = conns_[fd];
+        if (cmd == "ACQUIRE" && c.state == State::Idle) {
+            string name, cls; int weight = 0;
+            is >> name >> weight >> cls;   // hints only
+            if (cls.empty()) return false;
+            auto& cl = clients_[c.user];
+            auto w = weights_.find(c.user);
+            cl.weight = w == weights_.end() ? 1 : w->second;
+            if (weight > 0) cl.weight = std::min(cl.weight, weight);
+            c.interactive = cls == "interactive" && cl.interactive < size_t(kInteractivePerClient);
+            if (c.interactive) ++cl.interactive;
+            if (cl.queue.empty() && cl.running == 0) cl.vtime = std::max(cl.vtime, minActiveVtime());
+            cl.queue.push_back(fd);
+            c.state = State::Queued;
+            c.queuedAt = Clock::now();
+            return true;
+        }
+        if (cmd == "DONE") return false;   // release via drop()
+        if (cmd == "STATS") { (void)sendAll(fd, stats()); return false; }
+        return false;
+    }
+
+    // A client returning from idle starts at the current service level, so it
+    // cannot bank credit while away and then starve everyone else.
+    double minActiveVtime() const {
+        double m = -1;
+        for (auto& [n, cl] : clients_)
+            if (!cl.queue.empty() || cl.running) m = (m < 0) ? cl.vtime : std::min(m, cl.vtime);
+        return m < 0 ? 0 : m;
+    }
+
+    void drop(int fd) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) return;
+        auto& c = it->second;
+        if (c.state == State::Queued) {
+            auto& q = clients_[c.user].queue;
+            q.erase(std::remove(q.begin(), q.end(), fd), q.end());
+        } else if (c.state == State::Running) {
+            --running_;
+            --clients_[c.user].running;
+        }
+        if (c.state != State::Idle && c.interactive) --clients_[c.user].interactive;
+        close(fd);
+        conns_.erase(it);
+    }
+
+    // Picks the queued client with least vtime, interactive waiters first.
+    void dispatch() {
+        while (running_ < slots_) {
+            Client* best = nullptr; bool bestInter = false;
+            for (auto& [name, cl] : clients_) {
+                if (cl.queue.empty()) continue;
+                bool inter = false;
+                for (int fd : cl.queue) if (conns_[fd].interactive) { inter = true; break; }
+                if (!best || (inter && !bestInter) || (inter == bestInter && cl.vtime < best->vtime)) {
+                    best = &cl; bestInter = inter;
+                }
+            }
+            if (!best) return;
+            auto qit = best->queue.begin();
+            if (bestInter)
+                while (!conns_[*qit].interactive) ++qit;
+            int fd = *qit;
+            best->queue.erase(qit);
+            auto& c = conns_[fd];
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - c.queuedAt).count();
+            auto& ws = wait_[c.interactive ? 1 : 0];
+            ++ws.n; ws.totalUs += us; ws.maxUs = std::max(ws.maxUs, us);
+            c.state = State::Running;
+            ++running_; ++best->running; ++best->granted;
+            best->vtime += 1.0 / best->weight;
+            if (!sendAll(fd, "GO " + std::to_string((long long)us) + "\n")) drop(fd);
+        }
+    }
+
+    // Tells every queued job it is still queued, and where in its client's queue.
+    // Never blocks: a client that does not read just misses beats.
+    void keepalive() {
+        for (auto& [name, cl] : clients_)
+            for (size_t i = 0; i < cl.queue.size(); ++i) {
+                string line = "WAIT " + std::to_string(i + 1) + "\n";
+                (void)send(cl.queue[i], line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            }
+    }
+
+    string stats() const {
+        std::ostringstream os;
+        size_t queued = 0;
+        for (auto& [n, cl] : clients_) queued += cl.queue.size();
+        os << "slots " << slots_ << "\nrunning " << running_ << "\nqueued " << queued << "\n";
+        const char* cls[2] = {"batch", "interactive"};
+        for (int i = 0; i < 2; ++i)
+            os << "wait_" << cls[i] << " n=" << wait_[i].n
+               << " avg_ms=" << (wait_[i].n ? wait_[i].totalUs / wait_[i].n / 1000.0 : 0.0)
+               << " max_ms=" << wait_[i].maxUs / 1000.0 << "\n";
+        for (auto& [n, cl] : clients_)
+            os << "client " << n << " weight=" << cl.weight << " queued=" << cl.queue.size()
+               << " running=" << cl.running << " granted=" << cl.granted << "\n";
+        os << "END\n";
+        return os.str();
+    }
+};
+#endif
+
+} // namespace sched
+} // namespace scripted
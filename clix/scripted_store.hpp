@@ -0,0 +1,395 @@
+// scripted_store.hpp — append-only artifact store for plugin runs
+// C++23, header-only. Place beside scripted_core.hpp.
+//
+// With `:set artifacts store`, a run's code/input/output/log/err go into one
+// record appended to a segment file instead of a directory of small files:
+//   files/out/artifacts/seg-NNNNNN.dat   records, rolled at kSegmentBytes
+//   files/out/artifacts/index.tsv        one line per record -> segment/offset
+//   files/out/artifacts/lock             serialises writers across sessions
+// Record: "SAR1" | u64 length | u64 run | i64 bank, reg, first, last, time |
+//         i32 exit | u32 plugin length | plugin | 5 x (u64 length, bytes)
+// (host byte order, like the bloom sidecars). A record covers one cell, or
+// first..last for a batch. Retention keeps the newest `keep` runs per
+// (bank, reg, first, last, plugin); compaction rewrites only those into fresh
+// segments and swaps in a new index generation.
+#pragma once
+#include "scripted_core.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+namespace scripted {
+namespace store {
+
+using std::string;
+
+enum Field { Code, Input, Output, Log, Err, FieldCount };
+
+struct Artifact {
+    uint64_t  run = 0;
+    long long bank = 0, reg = 0, first = 0, last = 0;
+    string    plugin;
+    long long time = 0;
+    int       exit = -1;
+    string    field[FieldCount]{};
+};
+
+// Index entry: where a record lives, plus enough of its header to list it.
+struct Ref {
+    uint64_t  run = 0;
+    long long bank = 0, reg = 0, first = 0, last = 0;
+    string    plugin;
+    uint32_t  seg = 0;
+    uint64_t  offset = 0, length = 0;
+    long long time = 0;
+    int       exit = -1;
+};
+
+struct Stats {
+    size_t   records = 0, live = 0, segments = 0;
+    uint64_t bytes = 0, deadBytes = 0;
+};
+
+class ArtifactStore {
+public:
+    static constexpr uint64_t kSegmentBytes = 64ull << 20;
+
+    explicit ArtifactStore(fs::path dir) : dir_(std::move(dir)) {}
+
+    const fs::path& dir() const { return dir_; }
+
+    // Appends one record; fills a.run. False (with err) if the write failed.
+    bool append(Artifact& a, string& err) {
+        std::lock_guard<std::mutex> g(mu_);
+        FileLock fl(dir_);
+        if (!fl.ok) { err = "cannot lock " + (dir_ / "lock").string(); return false; }
+        refresh();
+        if (indexRead_ == 0) {
+            const string hdr = "SAI1\t" + std::to_string(generation_) + "\n";
+            if (!putFile(indexPath(), hdr)) { err = "cannot write " + indexPath().string(); return false; }
+            indexRead_ = hdr.size();
+        }
+        a.run = nextRun_++;
+        if (!a.time) a.time = static_cast<long long>(std::time(nullptr));
+        string rec = encode(a);
+
+        uint32_t seg = lastSeg_ ? lastSeg_ : 1;
+        std::error_code ec;
+        uint64_t segSize = fs::exists(segPath(seg), ec) ? fs::file_size(segPath(seg), ec) : 0;
+        if (segSize && segSize + rec.size() > kSegmentBytes) { ++seg; segSize = 0; }
+        if (!putFile(segPath(seg), rec)) { err = "cannot write " + segPath(seg).string(); return false; }
+
+        Ref r{a.run, a.bank, a.reg, a.first, a.last, a.plugin, seg, segSize, rec.size(), a.time, a.exit};
+        if (!putFile(indexPath(), indexLine(r))) { err = "cannot write " + indexPath().string(); return false; }
+        indexRead_ += indexLine(r).size();
+        add(std::move(r));
+        return true;
+    }
+
+    // Newest record of `plugin` covering bank/reg/addr (or exactly run `run` when non-zero).
+    bool lookup(long long bank, long long reg, long long addr, const string& plugin, uint64_t run, Ref& out) {
+        std::lock_guard<std::mutex> g(mu_);
+        refresh();
+        bool found = false;
+        auto lo = std::make_tuple(bank, reg, plugin, addr - maxSpan_);
+        auto hi = std::make_tuple(bank, reg, plugin, addr);
+        for (auto it = byCell_.lower_bound(lo); it != byCell_.end() && it->first <= hi; ++it)
+            for (size_t i : it->second) {
+                const Ref& r = refs_[i];
+                if (r.last < addr || (run && r.run != run)) continue;
+                if (!found || r.run > out.run) { out = r; found = true; }
+            }
+        return found;
+    }
+
+    // All runs of `plugin` (any plugin when empty) covering bank/reg/addr, oldest first.
+    std::vector<Ref> history(long long bank, long long reg, long long addr, const string& plugin) {
+        std::lock_guard<std::mutex> g(mu_);
+        refresh();
+        std::vector<Ref> out;
+        for (auto& r : refs_)
+            if (r.bank == bank && r.reg == reg && r.first <= addr && addr <= r.last &&
+                (plugin.empty() || r.plugin == plugin)) out.push_back(r);
+        return out;
+    }
+
+    // Newest run per (bank, reg, first, last, plugin).
+    std::vector<Ref> newest() {
+        std::lock_guard<std::mutex> g(mu_);
+        refresh();
+        std::vector<bool> live = liveMask(1);
+        std::vector<Ref> out;
+        for (size_t i = 0; i < refs_.size(); ++i) if (live[i]) out.push_back(refs_[i]);
+        return out;
+    }
+
+    // Approximate heap held by the in-memory index.
+    uint64_t memoryBytes() {
+        std::lock_guard<std::mutex> g(mu_);
+        uint64_t n = heapChunk(refs_.capacity() * sizeof(Ref));
+        for (auto& r : refs_) n += stringHeap(r.plugin);
+        for (auto& [k, v] : byCell_)
+            n += heapChunk(32 + sizeof(std::pair<const decltype(byCell_)::key_type, std::vector<size_t>>)) +
+                 heapChunk(v.capacity() * sizeof(size_t)) + stringHeap(std::get<2>(k));
+        return n;
+    }
+
+    bool read(const Ref& r, Artifact& a, string& err) {
+        std::ifstream in(segPath(r.seg), std::ios::binary);
+        if (!in) { err = "missing segment " + segPath(r.seg).string(); return false; }
+        string rec(r.length, '\0');
+        in.seekg(static_cast<std::streamoff>(r.offset));
+        bool ok = in && in.read(rec.data(), static_cast<std::streamsize>(rec.size()));
+        if (!ok || !decode(rec, a)) { err = "corrupt record for run " + std::to_string(r.run); return false; }
+        return true;
+    }
+
+    // Newest `keep` runs per key are live (keep <= 0: all).
+    Stats stats(int keep) {
+        std::lock_guard<std::mutex> g(mu_);
+        refresh();
+        Stats s;
+        std::vector<bool> live = liveMask(keep);
+        s.records = refs_.size();
+        for (size_t i = 0; i < refs_.size(); ++i) {
+            s.bytes += refs_[i].length;
+            if (live[i]) ++s.live; else s.deadBytes += refs_[i].length;
+        }
+        std::error_code ec;
+        if (fs::exists(dir_, ec))
+            for (auto& e : fs::directory_iterator(dir_, ec))
+                if (e.path().extension() == ".dat") ++s.segments;
+        return s;
+    }
+
+    // Rewrites live records into new segments, then replaces the index and drops
+    // the old segments. Returns false (store untouched) on any write error.
+    bool compact(int keep, Stats& after, string& err) {
+        {
+            std::lock_guard<std::mutex> g(mu_);
+            FileLock fl(dir_);
+            if (!fl.ok) { err = "cannot lock " + (dir_ / "lock").string(); return false; }
+            refresh();
+            std::vector<bool> live = liveMask(keep);
+            std::vector<uint32_t> oldSegs;
+            std::error_code ec;
+            for (auto& e : fs::directory_iterator(dir_, ec))
+                if (e.path().extension() == ".dat")
+                    oldSegs.push_back(static_cast<uint32_t>(std::strtoul(e.path().stem().string().c_str() + 4, nullptr, 10)));
+
+            const uint32_t firstNew = lastSeg_ + 1;
+            uint32_t seg = firstNew;
+            uint64_t segSize = 0;
+            auto fail = [&](string msg) {
+                for (uint32_t s = firstNew; s <= seg; ++s) fs::remove(segPath(s), ec);
+                err = std::move(msg);
+                return false;
+            };
+            string index = "SAI1\t" + std::to_string(generation_ + 1) + "\n";
+            for (size_t i = 0; i < refs_.size(); ++i) {
+                if (!live[i]) continue;
+                Artifact a;
+                string rerr;
+                if (!read(refs_[i], a, rerr)) return fail(rerr);
+                string rec = encode(a);
+                if (segSize && segSize + rec.size() > kSegmentBytes) { ++seg; segSize = 0; }
+                if (!putFile(segPath(seg), rec)) return fail("cannot write " + segPath(seg).string());
+                Ref r = refs_[i];
+                r.seg = seg; r.offset = segSize; r.length = rec.size();
+                segSize += rec.size();
+                index += indexLine(r);
+            }
+            fs::path tmp = indexPath();
+            tmp += ".tmp";
+            if (!putFile(tmp, index, "wb")) return fail("cannot write " + tmp.string());
+            fs::rename(tmp, indexPath(), ec);
+            if (ec) return fail("cannot replace index: " + ec.message());
+            for (uint32_t s : oldSegs) fs::remove(segPath(s), ec);
+            loaded_ = false;
+        }
+        after = stats(keep);
+        return true;
+    }
+
+private:
+    // Exclusive advisory lock on dir/lock for the lifetime of the object (POSIX);
+    // other platforms rely on the in-process mutex only.
+    struct FileLock {
+        bool ok = true;
+#if !defined(_WIN32)
+        int fd = -1;
+        explicit FileLock(const fs::path& dir) {
+            std::error_code ec;
+            fs::create_directories(dir, ec);
+            fd = ::open((dir / "lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            ok = fd >= 0 && flock(fd, LOCK_EX) == 0;
+        }
+        ~FileLock() { if (fd >= 0) ::close(fd); }
+#else
+        explicit FileLock(const fs::path& dir) { std::error_code ec; fs::create_directories(dir, ec); }
+#endif
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+    };
+
+    fs::path dir_;
+    std::mutex mu_;
+    std::vector<Ref> refs_;
+    std::map<std::tuple<long long, long long, string, long long>, std::vector<size_t>> byCell_;
+    long long maxSpan_ = 0;
+    uint64_t  nextRun_ = 1;
+    uint32_t  lastSeg_ = 0;
+    uint64_t  generation_ = 0;
+    uint64_t  indexRead_ = 0;   // bytes of index.tsv already applied
+    bool      loaded_ = false;
+
+    fs::path segPath(uint32_t seg) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "seg-%06u.dat", seg);
+        return dir_ / name;
+    }
+    fs::path indexPath() const { return dir_ / "index.tsv"; }
+
+    static bool putFile(const fs::path& p, const string& data, const char* mode = "ab") {
+        std::FILE* f = std::fopen(p.string().c_str(), mode);
+        if (!f) return false;
+        bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+    static string indexLine(const Ref& r) {
+        std::ostringstream os;
+        os << r.run << '\t' << r.bank << '\t' << r.reg << '\t' << r.first << '\t' << r.last << '\t'
+           << r.plugin << '\t' << r.seg << '\t' << r.offset << '\t' << r.length << '\t'
+           << r.time << '\t' << r.exit << '\n';
+        return os.str();
+    }
+
+    void add(Ref r) {
+        maxSpan_ = std::max(maxSpan_, r.last - r.first);
+        nextRun_ = std::max(nextRun_, r.run + 1);
+        lastSeg_ = std::max(lastSeg_, r.seg);
+        byCell_[std::make_tuple(r.bank, r.reg, r.plugin, r.first)].push_back(refs_.size());
+        refs_.push_back(std::move(r));
+    }
+
+    // Applies index lines appended by this or other sessions since the last call
+    // (only the new tail is read); reloads from scratch when another session
+    // compacted (new generation).
+    void refresh() {
+        std::ifstream in(indexPath(), std::ios::binary);
+        string head;
+        uint64_t gen = 0, size = 0, body = 0;
+        if (in && std::getline(in, head) && head.compare(0, 5, "SAI1\t") == 0) {
+            gen = std::strtoull(head.c_str() + 5, nullptr, 10);
+            body = head.size() + 1;
+        }
+        in.clear();
+        if (in.seekg(0, std::ios::end)) size = static_cast<uint64_t>(in.tellg());
+        if (!loaded_ || gen != generation_ || size < indexRead_) {
+            refs_.clear(); byCell_.clear();
+            maxSpan_ = 0; nextRun_ = 1; lastSeg_ = 0;
+            generation_ = gen; indexRead_ = body; loaded_ = true;
+            std::error_code ec;
+            if (fs::exists(dir_, ec))
+                for (auto& e : fs::directory_iterator(dir_, ec))
+                    if (e.path().extension() == ".dat")
+                        lastSeg_ = std::max(lastSeg_, static_cast<uint32_t>(
+                            std::strtoul(e.path().stem().string().c_str() + 4, nullptr, 10)));
+        }
+        if (size <= indexRead_) return;
+        string tail(size - indexRead_, '\0');
+        in.seekg(static_cast<std::streamoff>(indexRead_));
+        if (!in.read(tail.data(), static_cast<std::streamsize>(tail.size()))) return;
+        size_t pos = 0;
+        std::vector<string> f;
+        while (pos < tail.size()) {
+            size_t nl = tail.find('\n', pos);
+            if (nl == string::npos) break; // torn tail from a crashed writer
+            f.clear();
+            for (size_t b = pos; b <= nl; ) {
+                size_t t = tail.find('\t', b);
+                if (t == string::npos || t > nl) t = nl;
+                f.emplace_back(tail, b, t - b);
+                b = t + 1;
+            }
+            if (f.size() == 11) {
+                try {
+                    Ref r;
+                    r.run = std::stoull(f[0]); r.bank = std::stoll(f[1]); r.reg = std::stoll(f[2]);
+                    r.first = std::stoll(f[3]); r.last = std::stoll(f[4]); r.plugin = f[5];
+                    r.seg = static_cast<uint32_t>(std::stoul(f[6])); r.offset = std::stoull(f[7]);
+                    r.length = std::stoull(f[8]); r.time = std::stoll(f[9]); r.exit = std::stoi(f[10]);
+                    add(std::move(r));
+                } catch (...) {}
+            }
+            pos = nl + 1;
+        }
+        indexRead_ += pos;
+    }
+
+    std::vector<bool> liveMask(int keep) const {
+        std::vector<bool> live(refs_.size(), true);
+        if (keep <= 0) return live;
+        std::map<std::tuple<long long, long long, long long, long long, string>, int> seen;
+        for (size_t i = refs_.size(); i-- > 0; ) {
+            const Ref& r = refs_[i];
+            live[i] = ++seen[std::make_tuple(r.bank, r.reg, r.first, r.last, r.plugin)] <= keep;
+        }
+        return live;
+    }
+
+    static string encode(const Artifact& a) {
+        string s("SAR1", 4);
+        auto put = [&](const void* p, size_t n){ s.append(static_cast<const char*>(p), n); };
+        uint64_t len = 0;
+        put(&len, 8);
+        put(&a.run, 8); put(&a.bank, 8); put(&a.reg, 8); put(&a.first, 8); put(&a.last, 8); put(&a.time, 8);
+        put(&a.exit, 4);
+        uint32_t pl = static_cast<uint32_t>(a.plugin.size());
+        put(&pl, 4); put(a.plugin.data(), pl);
+        for (auto& f : a.field) { uint64_t n = f.size(); put(&n, 8); put(f.data(), f.size()); }
+        len = s.size();
+        std::memcpy(s.data() + 4, &len, 8);
+        return s;
+    }
+
+    static bool decode(const string& s, Artifact& a) {
+        size_t p = 0;
+        auto get = [&](void* dst, size_t n) {
+            if (p + n > s.size()) return false;
+            std::memcpy(dst, s.data() + p, n); p += n; return true;
+        };
+        if (s.size() < 12 || s.compare(0, 4, "SAR1") != 0) return false;
+        uint64_t len = 0;
+        p = 4;
+        if (!get(&len, 8) || len != s.size()) return false;
+        uint32_t pl = 0;
+        if (!get(&a.run, 8) || !get(&a.bank, 8) || !get(&a.reg, 8) || !get(&a.first, 8) || !get(&a.last, 8) ||
+            !get(&a.time, 8) || !get(&a.exit, 4) || !get(&pl, 4) || p + pl > s.size()) return false;
+        a.plugin.assign(s, p, pl); p += pl;
+        for (auto& f : a.field) {
+            uint64_t n = 0;
+            if (!get(&n, 8) || p + n > s.size()) return false;
+            f.assign(s, p, n); p += n;
+        }
+        return p == s.size();
+    }
+};
+
+} // namespace store
+} // namespace scripted